@@ -0,0 +1,150 @@
+import re
+
+
+class BenchConfig:
+    def __init__(self, file_path):
+        self.file_path = file_path
+
+    # graph name -> input files and parameters shared by every platform
+    def get_graphs(self):
+        return {
+            'example': {
+                'edges': '/data/graphs/example.e',          # binary edge list (Gemini)
+                'flash_dir': '/data/graphs/flash/',         # Flash dataset directory and name
+                'flash_name': 'example',
+                'adj': '/data/graphs/example.adj',          # adjacency text (Ligra, Pregel)
+                'scc': '/data/graphs/example.scc',          # OWCTY in/out adjacency text (Pregel CC)
+                'efile': '/data/graphs/example.e.txt',      # edge text (Grape, PowerGraph)
+                'vfile': '/data/graphs/example.v.txt',
+                'vertices': 1000000,
+                'root': 0,
+                'k': 4                                      # kCore and kClique
+            }
+        }
+
+    # command line of one run; {name} fields are filled from the graph entry.
+    # Point the binaries at your builds, missing entries are skipped. There is
+    # one entry per implementation under code/.
+    # Grape logs its phase and superstep times with VLOG(2), so its runs need
+    # --v=2 --logtostderr (or GLOG_v=2 GLOG_logtostderr=1 in the environment).
+    # Pregel+ apps are functions (test_pagerank, test_sssp, pregel_owcty), run
+    # is a main that calls the one named by its first argument.
+    # The Graphx examples read their inputs from fixed paths.
+    def get_commands(self):
+        glog = '--v=2 --logtostderr'
+        return {
+            'Gemini': {
+                'PageRank': './gemini/toolkits/pagerank {edges} {vertices} 20',
+                'SSSP': './gemini/toolkits/sssp {edges} {vertices} {root}',
+                'BC': './gemini/toolkits/bc {edges} {vertices} {root}'
+            },
+            'Grape': {
+                'PageRank': './grape/run_app --application pagerank --efile {efile} --vfile {vfile} --pr_mr 20 ' + glog,
+                'SSSP': './grape/run_app --application sssp --efile {efile} --vfile {vfile} --sssp_source {root} ' + glog,
+                'CC': './grape/run_app --application wcc --efile {efile} --vfile {vfile} ' + glog,
+                'LPA': './grape/run_app --application cdlp --efile {efile} --vfile {vfile} --cdlp_mr 10 ' + glog,
+                'TriangleCounting': './grape/run_app --application triangle_count --efile {efile} --vfile {vfile} ' + glog
+            },
+            'Flash': {
+                'PageRank': './flash/bin/pagerank {flash_dir} {flash_name}',
+                'SSSP': './flash/run_app --application sssp --efile {efile} --vfile {vfile} --sssp_source {root} ' + glog,
+                'BC': './flash/bin/bc {flash_dir} {flash_name} {root}',
+                'CC': './flash/bin/cc {flash_dir} {flash_name}',
+                'LPA': './flash/bin/lpa {flash_dir} {flash_name}',
+                'TriangleCounting': './flash/bin/tc {flash_dir} {flash_name}',
+                'kClique': './flash/bin/kclique {flash_dir} {flash_name} {k}',
+                'kCore': './flash/bin/kcore {flash_dir} {flash_name} {k}'
+            },
+            'Ligra': {
+                'PageRank': './ligra/apps/PageRank {adj}',
+                'SSSP': './ligra/apps/SSSP -r {root} {adj}',
+                'BC': './ligra/apps/BC -r {root} {adj}',
+                'CC': './ligra/apps/CC {adj}',
+                'TriangleCounting': './ligra/apps/TriangleCounting -s {adj}',
+                'kCore': './ligra/apps/kCore -s {adj}'
+            },
+            'Pregel': {
+                'PageRank': 'mpiexec -n 4 ./pregel/run pagerank {adj}',
+                'SSSP': 'mpiexec -n 4 ./pregel/run sssp {adj} {root}',
+                'CC': 'mpiexec -n 4 ./pregel/run owcty {scc}'
+            },
+            'PowerGraph': {
+                'PageRank': './powergraph/pagerank --graph {efile} --format tsv',
+                'SSSP': './powergraph/sssp --graph {efile} --format tsv --source {root}',
+                'BC': './powergraph/bc --graph {efile}',
+                'CC': './powergraph/cc --graph {efile} --format tsv',
+                'TriangleCounting': './powergraph/tc --graph {efile} --format tsv',
+                'kCore': './powergraph/kcore --graph {efile} --format tsv'
+            },
+            'Graphx': {
+                'PageRank': 'spark-submit --class PageRankExample ./graphx/examples.jar',
+                'SSSP': 'spark-submit --class SSSPExample ./graphx/examples.jar',
+                'CC': 'spark-submit --class ConnectedComponentsExample ./graphx/examples.jar',
+                'TriangleCounting': 'spark-submit --class TriangleCountingExample ./graphx/examples.jar'
+            }
+        }
+
+    # run before every measured run in cold mode
+    def get_cold_command(self):
+        return 'sync; echo 3 > /proc/sys/vm/drop_caches'
+
+    # phase name -> pattern whose first group is seconds; a pattern may match
+    # several times in one run (Gemini and Grape apps repeat their kernel)
+    def get_phase_patterns(self, platform):
+        return {
+            'Gemini': {
+                'load': r'load_time=([0-9.eE+-]+)\(s\)',
+                'exec': r'exec_time=([0-9.eE+-]+)\(s\)'
+            },
+            'Grape': {
+                'preprocess': r'preprocess_time: ([0-9.eE+-]+)s\.',
+                'exec': r'(?:exec|eval)_time: ([0-9.eE+-]+)s\.',
+                'postprocess': r'postprocess_time: ([0-9.eE+-]+)s\.'
+            },
+            'Flash': {
+                'exec': r'time=([0-9.eE+-]+) secs'
+            },
+            'Ligra': {
+                'exec': r'Running time : ([0-9.eE+-]+)'
+            },
+            'Pregel': {
+                'load': r'Load Time : ([0-9.eE+-]+) seconds',
+                'exec': r'Total Computational Time : ([0-9.eE+-]+) seconds',
+                'communication': r'Communication Time : ([0-9.eE+-]+) seconds',
+                'dump': r'Dump Time : ([0-9.eE+-]+) seconds'
+            },
+            'PowerGraph': {
+                'exec': r'Finished Running engine in ([0-9.eE+-]+)'
+            },
+            'Graphx': {}
+        }.get(platform, {})
+
+    # superstep lines: (pattern, field of each group); step is the superstep
+    # number, time its seconds and active its active vertex count
+    def get_superstep_pattern(self, platform):
+        return {
+            'Gemini': (r'active\((\d+)\)>=(\d+)', ['step', 'active']),
+            'Grape': (r'step (\d+) exec time: ([0-9.eE+-]+)s\.', ['step', 'time']),
+            'Pregel': (r'Superstep (\d+) done\. Time elapsed: ([0-9.eE+-]+) seconds', ['step', 'time'])
+        }.get(platform)
+
+    def parse_phases(self, platform, output):
+        phases = {}
+        for phase, pattern in self.get_phase_patterns(platform).items():
+            values = [float(v) for v in re.findall(pattern, output)]
+            if values:
+                phases[phase] = values
+        return phases
+
+    def parse_supersteps(self, platform, output):
+        entry = self.get_superstep_pattern(platform)
+        if entry is None:
+            return []
+        pattern, fields = entry
+        steps = []
+        for groups in re.findall(pattern, output):
+            step = {}
+            for field, value in zip(fields, groups):
+                step[field] = float(value) if field == 'time' else int(value)
+            steps.append(step)
+        return steps
@@ -0,0 +1,159 @@
+import argparse
+import json
+import math
+import os
+import subprocess
+import time
+
+import bench_config
+
+my_config = bench_config.BenchConfig(os.path.dirname(os.path.abspath(__file__)))
+
+# platforms = ['Flash', 'Gemini', 'Ligra', 'Grape', 'PowerGraph', 'Pregel', 'Graphx']
+platforms = ['Gemini', 'Grape']
+
+# algorithms = ['PageRank', 'SSSP', 'Louvain', 'kCore', 'BC', 'LPA', 'TriangleCounting', 'kClique', 'CC']
+algorithms = ['PageRank', 'SSSP']
+
+graphs = ['example']
+
+
+def percentile(values, p):
+    # nearest-rank percentile
+    ordered = sorted(values)
+    rank = max(1, int(math.ceil(p / 100.0 * len(ordered))))
+    return ordered[rank - 1]
+
+
+def summarize(values):
+    return {
+        'count': len(values),
+        'min': min(values),
+        'median': percentile(values, 50),
+        'p95': percentile(values, 95),
+        'max': max(values)
+    }
+
+
+def run_once(command, mode):
+    if mode == 'cold':
+        subprocess.call(my_config.get_cold_command(), shell=True)
+    start = time.time()
+    proc = subprocess.run(command, shell=True, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                          universal_newlines=True)
+    return proc.returncode, time.time() - start, proc.stdout
+
+
+def bench(platform, algorithm, graph_name, repetitions, mode, log_dir):
+    template = my_config.get_commands().get(platform, {}).get(algorithm)
+    if template is None:
+        print('skip ' + platform + ' ' + algorithm + ': no command')
+        return None
+    graph = my_config.get_graphs()[graph_name]
+    command = template.format(**graph)
+
+    if mode == 'warm':
+        # unmeasured run to fill the page cache
+        run_once(command, mode)
+
+    runs = []
+    for rep in range(repetitions):
+        code, wall, output = run_once(command, mode)
+        if log_dir is not None:
+            log_path = os.path.join(log_dir, '_'.join([platform, algorithm, graph_name, str(rep)]) + '.log')
+            with open(log_path, 'w') as file:
+                file.write(output)
+        if code != 0:
+            print('error ' + platform + ' ' + algorithm + ' ' + graph_name + ': exit code ' + str(code))
+        runs.append({
+            'repetition': rep,
+            'exit_code': code,
+            'wall': wall,
+            'phases': my_config.parse_phases(platform, output),
+            'supersteps': my_config.parse_supersteps(platform, output)
+        })
+        print(platform + ' ' + algorithm + ' ' + graph_name + ' ' + str(rep) + ': ' + '%.3lf' % wall + 's')
+
+    ok_runs = [run for run in runs if run['exit_code'] == 0]
+    summary = {}
+    if ok_runs:
+        summary['wall'] = summarize([run['wall'] for run in ok_runs])
+        phase_names = set()
+        for run in ok_runs:
+            phase_names.update(run['phases'].keys())
+        for phase in sorted(phase_names):
+            values = []
+            for run in ok_runs:
+                values += run['phases'].get(phase, [])
+            summary[phase] = summarize(values)
+
+    return {
+        'platform': platform,
+        'algorithm': algorithm,
+        'graph': graph_name,
+        'command': command,
+        'mode': mode,
+        'repetitions': repetitions,
+        'runs': runs,
+        'summary': summary
+    }
+
+
+def compare(results, baseline_path, threshold):
+    # flags every phase whose median grew by more than threshold (a fraction)
+    with open(baseline_path, 'r') as file:
+        baseline = json.load(file)
+    old = {}
+    for result in baseline:
+        old[(result['platform'], result['algorithm'], result['graph'])] = result['summary']
+    regressions = []
+    for result in results:
+        key = (result['platform'], result['algorithm'], result['graph'])
+        if key not in old:
+            continue
+        for phase, stats in result['summary'].items():
+            if phase not in old[key] or old[key][phase]['median'] <= 0:
+                continue
+            ratio = stats['median'] / old[key][phase]['median']
+            if ratio > 1 + threshold:
+                regressions.append(' '.join(key) + ' ' + phase + ': ' + '%.3lf' % old[key][phase]['median'] +
+                                   's -> ' + '%.3lf' % stats['median'] + 's (x' + '%.2lf' % ratio + ')')
+    return regressions
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='runs every platform of an algorithm on the same inputs')
+    parser.add_argument('--platforms', nargs='+', default=platforms)
+    parser.add_argument('--algorithms', nargs='+', default=algorithms)
+    parser.add_argument('--graphs', nargs='+', default=graphs)
+    parser.add_argument('--repetitions', type=int, default=5)
+    parser.add_argument('--mode', choices=['warm', 'cold'], default='warm')
+    parser.add_argument('--output', default='benchmark.json')
+    parser.add_argument('--logs', default=None, help='directory for the output of every run')
+    parser.add_argument('--baseline', default=None, help='earlier --output to compare medians with')
+    parser.add_argument('--threshold', type=float, default=0.1)
+    args = parser.parse_args()
+
+    if args.logs is not None and not os.path.isdir(args.logs):
+        os.makedirs(args.logs)
+
+    results = []
+    for algorithm in args.algorithms:
+        for graph_name in args.graphs:
+            for platform in args.platforms:
+                result = bench(platform, algorithm, graph_name, args.repetitions, args.mode, args.logs)
+                if result is not None:
+                    results.append(result)
+                    for phase, stats in result['summary'].items():
+                        print('  ' + phase + ': median ' + '%.3lf' % stats['median'] + 's, p95 ' +
+                              '%.3lf' % stats['p95'] + 's')
+
+    with open(args.output, 'w') as file:
+        json.dump(results, file, indent=2)
+
+    if args.baseline is not None:
+        regressions = compare(results, args.baseline, args.threshold)
+        for regression in regressions:
+            print('regression ' + regression)
+        if regressions:
+            exit(1)
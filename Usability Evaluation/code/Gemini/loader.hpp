@@ -0,0 +1,315 @@
+#ifndef LOADER_HPP
+#define LOADER_HPP
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <string>
+
+#include "core/graph.hpp"
+
+/*
+  Snapshots of a loaded graph.
+
+  load_directed_cached() restores the partitioned CSR/CSC that
+  Graph::load_directed builds for this partition from the file
+  <prefix>.<partitions>.<partition_id>. If that file is missing or was
+  written for a different layout, it loads the edge file and writes the
+  snapshot. The snapshot holds this partition only, so a restore does no
+  shuffle. It also records the edge count and mtime of the edge file, and
+  it is not used once the edge file changes. A snapshot that fails to write
+  is removed; one that fails to read is reported and the edge file is
+  loaded instead. Sections are page aligned and read with parallel preads of
+  SNAPSHOT_CHUNK bytes. The load time is printed on its own, apart from
+  exec_time.
+*/
+
+const size_t SNAPSHOT_CHUNK = 64ul << 20;
+const size_t SNAPSHOT_ALIGN = 4096;
+const unsigned SNAPSHOT_MAGIC = 0x32534e50; // "PNS2"
+
+struct SnapshotHeader {
+  unsigned magic;
+  int partitions;
+  int partition_id;
+  int sockets;
+  VertexId vertices;
+  EdgeId edges;
+  size_t edge_unit_size;
+  long input_mtime; // of the edge file, whose size gives edges
+};
+
+inline long input_mtime(const char * path) {
+  struct stat st;
+  if (stat(path, &st)==-1) return -1;
+  return (long)st.st_mtime;
+}
+
+// ok() turns false at the first failed write, later sections are skipped
+class SnapshotWriter {
+  int fd;
+  size_t pos;
+  bool good;
+  void write_all(const void * data, size_t size) {
+    size_t done = 0;
+    while (good && done < size) {
+      ssize_t ret = write(fd, (const char *)data + done, size - done);
+      if (ret<=0) {
+        good = false;
+        break;
+      }
+      done += ret;
+    }
+  }
+public:
+  SnapshotWriter(int fd) : fd(fd), pos(0), good(true) { }
+  bool ok() const { return good; }
+  void section(const void * data, size_t size) {
+    write_all(data, size);
+    pos += size;
+    size_t pad = (SNAPSHOT_ALIGN - pos % SNAPSHOT_ALIGN) % SNAPSHOT_ALIGN;
+    if (pad > 0) {
+      char zeros[SNAPSHOT_ALIGN] = {0};
+      write_all(zeros, pad);
+      pos += pad;
+    }
+  }
+};
+
+// ok() turns false at the first failed or short read (a truncated file),
+// later sections are skipped
+class SnapshotReader {
+  int fd;
+  size_t pos;
+  bool good;
+public:
+  SnapshotReader(int fd) : fd(fd), pos(0), good(true) { }
+  bool ok() const { return good; }
+  // large sections are split in chunks read by all threads
+  void section(void * data, size_t size) {
+    if (!good) return;
+    size_t chunks = (size + SNAPSHOT_CHUNK - 1) / SNAPSHOT_CHUNK;
+    int failed = 0;
+    #pragma omp parallel for schedule(dynamic, 1) reduction(max:failed)
+    for (size_t c_i=0;c_i<chunks;c_i++) {
+      size_t begin = c_i * SNAPSHOT_CHUNK;
+      size_t length = std::min(SNAPSHOT_CHUNK, size - begin);
+      size_t done = 0;
+      while (done < length) {
+        ssize_t ret = pread(fd, (char *)data + begin + done, length - done, pos + begin + done);
+        if (ret<=0) {
+          failed = 1;
+          break;
+        }
+        done += ret;
+      }
+    }
+    if (failed) good = false;
+    pos += size;
+    pos += (SNAPSHOT_ALIGN - pos % SNAPSHOT_ALIGN) % SNAPSHOT_ALIGN;
+  }
+};
+
+inline std::string snapshot_path(const std::string & prefix, int partitions, int partition_id) {
+  return prefix + "." + std::to_string(partitions) + "." + std::to_string(partition_id);
+}
+
+template <typename EdgeData>
+void save_snapshot(Graph<EdgeData> * graph, const char * input, const std::string & prefix) {
+  std::string path = snapshot_path(prefix, graph->partitions, graph->partition_id);
+  int fd = open(path.c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0644);
+  if (fd==-1) {
+    fprintf(stderr, "cannot write snapshot %s\n", path.c_str());
+    return;
+  }
+  SnapshotHeader header;
+  header.magic = SNAPSHOT_MAGIC;
+  header.partitions = graph->partitions;
+  header.partition_id = graph->partition_id;
+  header.sockets = graph->sockets;
+  header.vertices = graph->vertices;
+  header.edges = graph->edges;
+  header.edge_unit_size = graph->edge_unit_size;
+  header.input_mtime = input_mtime(input);
+
+  VertexId vertices = graph->vertices;
+  int sockets = graph->sockets;
+  SnapshotWriter writer(fd);
+  writer.section(&header, sizeof(header));
+  writer.section(graph->out_degree, sizeof(VertexId) * vertices);
+  writer.section(graph->in_degree, sizeof(VertexId) * vertices);
+  writer.section(graph->partition_offset, sizeof(VertexId) * (graph->partitions + 1));
+  writer.section(graph->local_partition_offset, sizeof(VertexId) * (sockets + 1));
+  writer.section(&graph->owned_vertices, sizeof(VertexId));
+  writer.section(graph->outgoing_edges, sizeof(EdgeId) * sockets);
+  writer.section(graph->incoming_edges, sizeof(EdgeId) * sockets);
+  writer.section(graph->compressed_outgoing_adj_vertices, sizeof(VertexId) * sockets);
+  writer.section(graph->compressed_incoming_adj_vertices, sizeof(VertexId) * sockets);
+  for (int s_i=0;s_i<sockets;s_i++) {
+    writer.section(graph->outgoing_adj_bitmap[s_i]->data, sizeof(unsigned long) * (WORD_OFFSET(vertices) + 1));
+    writer.section(graph->outgoing_adj_index[s_i], sizeof(EdgeId) * (vertices + 1));
+    writer.section(graph->outgoing_adj_list[s_i], graph->edge_unit_size * graph->outgoing_edges[s_i]);
+    writer.section(graph->compressed_outgoing_adj_index[s_i], sizeof(CompressedAdjIndexUnit) * (graph->compressed_outgoing_adj_vertices[s_i] + 1));
+    writer.section(graph->incoming_adj_bitmap[s_i]->data, sizeof(unsigned long) * (WORD_OFFSET(vertices) + 1));
+    writer.section(graph->incoming_adj_index[s_i], sizeof(EdgeId) * (vertices + 1));
+    writer.section(graph->incoming_adj_list[s_i], graph->edge_unit_size * graph->incoming_edges[s_i]);
+    writer.section(graph->compressed_incoming_adj_index[s_i], sizeof(CompressedAdjIndexUnit) * (graph->compressed_incoming_adj_vertices[s_i] + 1));
+  }
+  if (close(fd)==-1 || !writer.ok()) {
+    fprintf(stderr, "cannot write snapshot %s, removed\n", path.c_str());
+    unlink(path.c_str());
+  }
+}
+
+// frees what load_snapshot allocated, sockets_read of them holding adjacency
+template <typename EdgeData>
+void free_snapshot(Graph<EdgeData> * graph, int sockets_read) {
+  VertexId vertices = graph->vertices;
+  graph->dealloc_vertex_array(graph->out_degree);
+  graph->dealloc_vertex_array(graph->in_degree);
+  for (int s_i=0;s_i<sockets_read;s_i++) {
+    delete graph->outgoing_adj_bitmap[s_i];
+    numa_free(graph->outgoing_adj_index[s_i], sizeof(EdgeId) * (vertices + 1));
+    numa_free(graph->outgoing_adj_list[s_i], graph->edge_unit_size * graph->outgoing_edges[s_i]);
+    numa_free(graph->compressed_outgoing_adj_index[s_i], sizeof(CompressedAdjIndexUnit) * (graph->compressed_outgoing_adj_vertices[s_i] + 1));
+    delete graph->incoming_adj_bitmap[s_i];
+    numa_free(graph->incoming_adj_index[s_i], sizeof(EdgeId) * (vertices + 1));
+    numa_free(graph->incoming_adj_list[s_i], graph->edge_unit_size * graph->incoming_edges[s_i]);
+    numa_free(graph->compressed_incoming_adj_index[s_i], sizeof(CompressedAdjIndexUnit) * (graph->compressed_incoming_adj_vertices[s_i] + 1));
+  }
+  delete [] graph->partition_offset;
+  delete [] graph->local_partition_offset;
+  delete [] graph->outgoing_edges;
+  delete [] graph->incoming_edges;
+  delete [] graph->compressed_outgoing_adj_vertices;
+  delete [] graph->compressed_incoming_adj_vertices;
+  delete [] graph->outgoing_adj_bitmap;
+  delete [] graph->outgoing_adj_index;
+  delete [] graph->outgoing_adj_list;
+  delete [] graph->compressed_outgoing_adj_index;
+  delete [] graph->incoming_adj_bitmap;
+  delete [] graph->incoming_adj_index;
+  delete [] graph->incoming_adj_list;
+  delete [] graph->compressed_incoming_adj_index;
+}
+
+// returns false if there is no usable snapshot: the graph is left untouched,
+// or freed again if the snapshot could not be read
+template <typename EdgeData>
+bool load_snapshot(Graph<EdgeData> * graph, const char * input, const std::string & prefix, VertexId vertices) {
+  std::string path = snapshot_path(prefix, graph->partitions, graph->partition_id);
+  int fd = open(path.c_str(), O_RDONLY);
+  int usable = 1;
+  SnapshotHeader header;
+  // the edge count load_directed would find in the input
+  EdgeId input_edges = file_size(input) / graph->edge_unit_size;
+  if (fd==-1 || pread(fd, &header, sizeof(header), 0)!=sizeof(header)
+      || header.magic!=SNAPSHOT_MAGIC || header.partitions!=graph->partitions
+      || header.partition_id!=graph->partition_id || header.sockets!=graph->sockets
+      || header.vertices!=vertices || header.edge_unit_size!=graph->edge_unit_size
+      || header.edges!=input_edges || header.input_mtime!=input_mtime(input)) {
+    usable = 0;
+  }
+  // every partition has to take the same path
+  MPI_Allreduce(MPI_IN_PLACE, &usable, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+  if (!usable) {
+    if (fd!=-1) close(fd);
+    return false;
+  }
+
+  int sockets = graph->sockets;
+  graph->symmetric = false;
+  graph->vertices = header.vertices;
+  graph->edges = header.edges;
+  graph->out_degree = graph->template alloc_interleaved_vertex_array<VertexId>();
+  graph->in_degree = graph->template alloc_interleaved_vertex_array<VertexId>();
+  graph->partition_offset = new VertexId [graph->partitions + 1];
+  graph->local_partition_offset = new VertexId [sockets + 1];
+  graph->outgoing_edges = new EdgeId [sockets];
+  graph->incoming_edges = new EdgeId [sockets];
+  graph->compressed_outgoing_adj_vertices = new VertexId [sockets];
+  graph->compressed_incoming_adj_vertices = new VertexId [sockets];
+  graph->outgoing_adj_bitmap = new Bitmap * [sockets];
+  graph->outgoing_adj_index = new EdgeId* [sockets];
+  graph->outgoing_adj_list = new AdjUnit<EdgeData>* [sockets];
+  graph->compressed_outgoing_adj_index = new CompressedAdjIndexUnit* [sockets];
+  graph->incoming_adj_bitmap = new Bitmap * [sockets];
+  graph->incoming_adj_index = new EdgeId* [sockets];
+  graph->incoming_adj_list = new AdjUnit<EdgeData>* [sockets];
+  graph->compressed_incoming_adj_index = new CompressedAdjIndexUnit* [sockets];
+
+  SnapshotReader reader(fd);
+  int sockets_read = 0;
+  reader.section(&header, sizeof(header));
+  reader.section(graph->out_degree, sizeof(VertexId) * vertices);
+  reader.section(graph->in_degree, sizeof(VertexId) * vertices);
+  reader.section(graph->partition_offset, sizeof(VertexId) * (graph->partitions + 1));
+  reader.section(graph->local_partition_offset, sizeof(VertexId) * (sockets + 1));
+  reader.section(&graph->owned_vertices, sizeof(VertexId));
+  reader.section(graph->outgoing_edges, sizeof(EdgeId) * sockets);
+  reader.section(graph->incoming_edges, sizeof(EdgeId) * sockets);
+  reader.section(graph->compressed_outgoing_adj_vertices, sizeof(VertexId) * sockets);
+  reader.section(graph->compressed_incoming_adj_vertices, sizeof(VertexId) * sockets);
+  for (int s_i=0;s_i<sockets;s_i++) {
+    // the sizes below come from sections already read
+    if (!reader.ok()) break;
+    graph->outgoing_adj_bitmap[s_i] = new Bitmap (vertices);
+    reader.section(graph->outgoing_adj_bitmap[s_i]->data, sizeof(unsigned long) * (WORD_OFFSET(vertices) + 1));
+    graph->outgoing_adj_index[s_i] = (EdgeId*)numa_alloc_onnode(sizeof(EdgeId) * (vertices + 1), s_i);
+    reader.section(graph->outgoing_adj_index[s_i], sizeof(EdgeId) * (vertices + 1));
+    graph->outgoing_adj_list[s_i] = (AdjUnit<EdgeData>*)numa_alloc_onnode(graph->edge_unit_size * graph->outgoing_edges[s_i], s_i);
+    reader.section(graph->outgoing_adj_list[s_i], graph->edge_unit_size * graph->outgoing_edges[s_i]);
+    graph->compressed_outgoing_adj_index[s_i] = (CompressedAdjIndexUnit*)numa_alloc_onnode(sizeof(CompressedAdjIndexUnit) * (graph->compressed_outgoing_adj_vertices[s_i] + 1), s_i);
+    reader.section(graph->compressed_outgoing_adj_index[s_i], sizeof(CompressedAdjIndexUnit) * (graph->compressed_outgoing_adj_vertices[s_i] + 1));
+    graph->incoming_adj_bitmap[s_i] = new Bitmap (vertices);
+    reader.section(graph->incoming_adj_bitmap[s_i]->data, sizeof(unsigned long) * (WORD_OFFSET(vertices) + 1));
+    graph->incoming_adj_index[s_i] = (EdgeId*)numa_alloc_onnode(sizeof(EdgeId) * (vertices + 1), s_i);
+    reader.section(graph->incoming_adj_index[s_i], sizeof(EdgeId) * (vertices + 1));
+    graph->incoming_adj_list[s_i] = (AdjUnit<EdgeData>*)numa_alloc_onnode(graph->edge_unit_size * graph->incoming_edges[s_i], s_i);
+    reader.section(graph->incoming_adj_list[s_i], graph->edge_unit_size * graph->incoming_edges[s_i]);
+    graph->compressed_incoming_adj_index[s_i] = (CompressedAdjIndexUnit*)numa_alloc_onnode(sizeof(CompressedAdjIndexUnit) * (graph->compressed_incoming_adj_vertices[s_i] + 1), s_i);
+    reader.section(graph->compressed_incoming_adj_index[s_i], sizeof(CompressedAdjIndexUnit) * (graph->compressed_incoming_adj_vertices[s_i] + 1));
+    sockets_read++;
+  }
+  close(fd);
+  int read_ok = reader.ok();
+  MPI_Allreduce(MPI_IN_PLACE, &read_ok, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+  if (!read_ok) {
+    if (!reader.ok()) {
+      fprintf(stderr, "cannot read snapshot %s, loading the edge file\n", path.c_str());
+    }
+    free_snapshot(graph, sockets_read);
+    return false;
+  }
+
+  // same as the end of load_directed: chunks for both directions
+  graph->transpose();
+  graph->tune_chunks();
+  graph->transpose();
+  graph->tune_chunks();
+  return true;
+}
+
+// snapshot_prefix may be NULL, then this is load_directed plus timing
+template <typename EdgeData>
+void load_directed_cached(Graph<EdgeData> * graph, const char * path, VertexId vertices, const char * snapshot_prefix) {
+  double load_time = 0;
+  load_time -= get_time();
+  bool restored = false;
+  if (snapshot_prefix!=NULL) {
+    restored = load_snapshot(graph, path, snapshot_prefix, vertices);
+  }
+  if (!restored) {
+    graph->load_directed(path, vertices);
+    if (snapshot_prefix!=NULL) {
+      save_snapshot(graph, path, snapshot_prefix);
+    }
+  }
+  load_time += get_time();
+  if (graph->partition_id==0) {
+    printf("load_time=%lf(s)%s\n", load_time, restored ? " (snapshot)" : "");
+  }
+}
+
+#endif
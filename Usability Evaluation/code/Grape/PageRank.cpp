@@ -4,6 +4,9 @@
 #include <test/test.h>
 #include <iomanip>
 
+#include "outer_vertex_combiner.h"
+#include "perf_counters.h"
+
 namespace test {
 
 /**
@@ -54,6 +57,10 @@ class PageRankContext : public VertexDataContext<FRAG_T, double> {
                            std::move(recv_buffers[i]));
     }
     step = 0;
+#ifdef PROFILING
+    // the thread pool is up by now, unlike in the constructor.
+    counters.Init(this->fragment().fid());
+#endif
   }
 
   void Output(std::ostream& os) override {
@@ -67,6 +74,7 @@ class PageRankContext : public VertexDataContext<FRAG_T, double> {
     VLOG(2) << "preprocess_time: " << preprocess_time << "s.";
     VLOG(2) << "exec_time: " << exec_time << "s.";
     VLOG(2) << "postprocess_time: " << postprocess_time << "s.";
+    counters.Output();
 #endif
   }
 
@@ -80,6 +88,7 @@ class PageRankContext : public VertexDataContext<FRAG_T, double> {
   double preprocess_time = 0;
   double exec_time = 0;
   double postprocess_time = 0;
+  PhaseCounters counters;
 #endif
 
   vid_t total_dangling_vnum = 0;
@@ -129,7 +138,9 @@ class PageRank : public BatchShuffleAppBase<FRAG_T, PageRankContext<FRAG_T>>,
     auto inner_vertices = frag.InnerVertices();
 
 #ifdef PROFILING
+    ctx.counters.BeginStep();
     ctx.exec_time -= GetCurrentTime();
+    ctx.counters.Start(PhaseCounters::kExec);
 #endif
 
     ctx.step = 0;
@@ -159,13 +170,16 @@ class PageRank : public BatchShuffleAppBase<FRAG_T, PageRankContext<FRAG_T>>,
     ctx.dangling_sum = p * ctx.total_dangling_vnum;
 
 #ifdef PROFILING
+    ctx.counters.Stop(PhaseCounters::kExec);
     ctx.exec_time += GetCurrentTime();
     ctx.postprocess_time -= GetCurrentTime();
+    ctx.counters.Start(PhaseCounters::kPostprocess);
 #endif
 
     messages.SyncInnerVertices<fragment_t, double>(frag, ctx.result,
                                                    thread_num());
 #ifdef PROFILING
+    ctx.counters.Stop(PhaseCounters::kPostprocess);
     ctx.postprocess_time += GetCurrentTime();
 #endif
   }
@@ -180,12 +194,16 @@ class PageRank : public BatchShuffleAppBase<FRAG_T, PageRankContext<FRAG_T>>,
     ctx.dangling_sum = base * ctx.total_dangling_vnum;
 
 #ifdef PROFILING
+    ctx.counters.BeginStep();
     ctx.preprocess_time -= GetCurrentTime();
+    ctx.counters.Start(PhaseCounters::kPreprocess);
 #endif
     messages.UpdateOuterVertices();
 #ifdef PROFILING
+    ctx.counters.Stop(PhaseCounters::kPreprocess);
     ctx.preprocess_time += GetCurrentTime();
     ctx.exec_time -= GetCurrentTime();
+    ctx.counters.Start(PhaseCounters::kExec);
 #endif
     ForEach(inner_vertices, [&ctx, &frag, base](int tid, vertex_t u) {
       double cur = 0;
@@ -197,6 +215,7 @@ class PageRank : public BatchShuffleAppBase<FRAG_T, PageRankContext<FRAG_T>>,
       ctx.next_result[u] = en > 0 ? (ctx.delta * cur + base) / en : base;
     });
 #ifdef PROFILING
+    ctx.counters.Stop(PhaseCounters::kExec);
     ctx.exec_time += GetCurrentTime();
 #endif
 
@@ -205,10 +224,12 @@ class PageRank : public BatchShuffleAppBase<FRAG_T, PageRankContext<FRAG_T>>,
     if (ctx.step != ctx.max_round) {
 #ifdef PROFILING
       ctx.postprocess_time -= GetCurrentTime();
+      ctx.counters.Start(PhaseCounters::kPostprocess);
 #endif
       messages.SyncInnerVertices<fragment_t, double>(frag, ctx.result,
                                                      thread_num());
 #ifdef PROFILING
+      ctx.counters.Stop(PhaseCounters::kPostprocess);
       ctx.postprocess_time += GetCurrentTime();
 #endif
     } else {
@@ -225,6 +246,291 @@ class PageRank : public BatchShuffleAppBase<FRAG_T, PageRankContext<FRAG_T>>,
   }
 };
 
+/**
+ * @brief Context for the residual (delta) version of PageRank.
+ *
+ * @tparam FRAG_T
+ */
+template <typename FRAG_T>
+class PageRankDeltaContext : public VertexDataContext<FRAG_T, double> {
+  using oid_t = typename FRAG_T::oid_t;
+  using vid_t = typename FRAG_T::vid_t;
+
+ public:
+  explicit PageRankDeltaContext(const FRAG_T& fragment)
+      : VertexDataContext<FRAG_T, double>(fragment, true),
+        result(this->data()) {}
+
+  /**
+   * @param delta damping factor, as in the batch version.
+   * @param max_round upper bound of rounds.
+   * @param tolerance L1 distance allowed from the converged ranks. A vertex
+   * stays active while its residual exceeds tolerance * (1 - delta) / (2|V|).
+   */
+  void Init(ParallelMessageManager& messages, double delta, int max_round,
+            double tolerance) {
+    auto& frag = this->fragment();
+    auto vertices = frag.Vertices();
+
+    this->delta = delta;
+    this->max_round = max_round;
+    this->tolerance = tolerance;
+    residual.Init(vertices, 0);
+    next_residual.Init(vertices, 0);
+    touched.Init(vertices);
+    curr_active.Init(vertices);
+    next_active.Init(vertices);
+    step = 0;
+
+#ifdef PROFILING
+    preprocess_time = 0;
+    exec_time = 0;
+    postprocess_time = 0;
+    counters.Init(frag.fid());
+#endif
+  }
+
+  void Output(std::ostream& os) override {
+    auto& frag = this->fragment();
+    auto inner_vertices = frag.InnerVertices();
+    for (auto v : inner_vertices) {
+      os << frag.GetId(v) << " " << std::scientific << std::setprecision(15)
+         << result[v] << std::endl;
+    }
+#ifdef PROFILING
+    VLOG(2) << "preprocess_time: " << preprocess_time << "s.";
+    VLOG(2) << "exec_time: " << exec_time << "s.";
+    VLOG(2) << "postprocess_time: " << postprocess_time << "s.";
+    counters.Output();
+#endif
+  }
+
+  typename FRAG_T::template vertex_array_t<double>& result;
+  typename FRAG_T::template vertex_array_t<double> residual;
+  typename FRAG_T::template vertex_array_t<double> next_residual;
+  // residual pushed to outer vertices, summed per vertex before sending.
+  OuterVertexCombiner<FRAG_T, double> outer_residual;
+  DenseVertexSet<typename FRAG_T::vertices_t> touched;
+  DenseVertexSet<typename FRAG_T::vertices_t> curr_active, next_active;
+
+#ifdef PROFILING
+  double preprocess_time = 0;
+  double exec_time = 0;
+  double postprocess_time = 0;
+  PhaseCounters counters;
+#endif
+
+  vid_t graph_vnum;
+  int step = 0;
+  int max_round = 0;
+  double delta = 0;
+  double tolerance = 0;
+  double threshold = 0;
+
+  // residual owed to every vertex by dangling vertices, applied to all
+  // vertices at once when it exceeds the threshold.
+  // (below the threshold it is left unabsorbed, like per-vertex residual)
+  double uniform_residual = 0;
+};
+
+/**
+ * @brief Residual (delta) PageRank, which can work on undirected graphs.
+ *
+ * Every vertex starts with residual (1 - delta) / |V|. An active vertex
+ * absorbs its residual into its rank and pushes delta * residual / degree to
+ * each neighbor; a vertex is active only while its residual is above the
+ * threshold, so late rounds touch the active vertices only.
+ *
+ * Residual left unabsorbed at the end, R in total, moves the ranks by at most
+ * R / (1 - delta) in L1 distance from the converged ones. Two kinds are left:
+ * per-vertex residual below the threshold, at most |V| * threshold, and the
+ * uniform residual of dangling vertices, below |V| * threshold as well. The
+ * threshold is tolerance * (1 - delta) / (2|V|), so each kind is at most
+ * half the tolerance and the ranks end within tolerance of the converged
+ * ones. This holds if the run stops by itself; a run cut short by max_round
+ * has no such bound.
+ *
+ * Residual pushed to an outer vertex is summed by an OuterVertexCombiner and
+ * sent to its owner once per round, only for outer vertices that received
+ * some.
+ *
+ * This version of PageRank inherits ParallelAppBase: the batch shuffle
+ * manager always ships every mirror, the parallel one ships per vertex.
+ *
+ * @tparam FRAG_T
+ */
+template <typename FRAG_T>
+class PageRankDelta
+    : public ParallelAppBase<FRAG_T, PageRankDeltaContext<FRAG_T>>,
+      public ParallelEngine,
+      public Communicator {
+ public:
+  INSTALL_PARALLEL_WORKER(PageRankDelta<FRAG_T>, PageRankDeltaContext<FRAG_T>,
+                          FRAG_T)
+
+  using vertex_t = typename FRAG_T::vertex_t;
+  using vid_t = typename FRAG_T::vid_t;
+
+  static constexpr bool need_split_edges = true;
+  static constexpr MessageStrategy message_strategy =
+      MessageStrategy::kSyncOnOuterVertex;
+  static constexpr LoadStrategy load_strategy = LoadStrategy::kOnlyOut;
+
+  PageRankDelta() = default;
+
+  void PEval(const fragment_t& frag, context_t& ctx,
+             message_manager_t& messages) {
+    auto inner_vertices = frag.InnerVertices();
+
+    messages.InitChannels(thread_num());
+    ctx.outer_residual.Init(frag, 0.0, thread_num());
+
+    if (ctx.max_round <= 0) {
+      return;
+    }
+
+#ifdef PROFILING
+    ctx.counters.BeginStep();
+    ctx.exec_time -= GetCurrentTime();
+    ctx.counters.Start(PhaseCounters::kExec);
+#endif
+
+    ctx.step = 0;
+    ctx.graph_vnum = frag.GetTotalVerticesNum();
+    // half of the tolerance for each kind of residual left over.
+    ctx.threshold =
+        ctx.tolerance * (1.0 - ctx.delta) / (2.0 * ctx.graph_vnum);
+    double r0 = (1.0 - ctx.delta) / ctx.graph_vnum;
+
+    ForEach(inner_vertices, [&ctx, r0](int tid, vertex_t u) {
+      ctx.result[u] = 0;
+      ctx.residual[u] = r0;
+      ctx.curr_active.Insert(u);
+    });
+
+#ifdef PROFILING
+    ctx.counters.Stop(PhaseCounters::kExec);
+    ctx.exec_time += GetCurrentTime();
+#endif
+
+    messages.ForceContinue();
+  }
+
+  void IncEval(const fragment_t& frag, context_t& ctx,
+               message_manager_t& messages) {
+    auto inner_vertices = frag.InnerVertices();
+    auto& channels = messages.Channels();
+    ++ctx.step;
+
+#ifdef PROFILING
+    ctx.counters.BeginStep();
+    ctx.preprocess_time -= GetCurrentTime();
+    ctx.counters.Start(PhaseCounters::kPreprocess);
+#endif
+
+    ctx.next_active.ParallelClear(GetThreadPool());
+    ctx.touched.ParallelClear(GetThreadPool());
+
+    messages.ParallelProcess<fragment_t, double>(
+        thread_num(), frag, [&ctx](int tid, vertex_t u, double msg) {
+          atomic_add(ctx.residual[u], msg);
+          if (ctx.residual[u] > ctx.threshold) {
+            ctx.curr_active.Insert(u);
+          }
+        });
+
+#ifdef PROFILING
+    ctx.counters.Stop(PhaseCounters::kPreprocess);
+    ctx.preprocess_time += GetCurrentTime();
+#endif
+
+    // messages of the last round only settle residuals.
+    if (ctx.step > ctx.max_round) {
+      return;
+    }
+
+#ifdef PROFILING
+    ctx.exec_time -= GetCurrentTime();
+    ctx.counters.Start(PhaseCounters::kExec);
+#endif
+
+    std::vector<double> dangling_tid(thread_num(), 0);
+    ForEach(ctx.curr_active, inner_vertices,
+            [&ctx, &frag, &dangling_tid](int tid, vertex_t u) {
+              double r = ctx.residual[u];
+              ctx.residual[u] = 0;
+              ctx.result[u] += r;
+              int en = frag.GetLocalOutDegree(u);
+              if (en == 0) {
+                dangling_tid[tid] += ctx.delta * r;
+                return;
+              }
+              double push = ctx.delta * r / en;
+              auto es = frag.GetOutgoingAdjList(u);
+              for (auto& e : es) {
+                vertex_t v = e.get_neighbor();
+                if (frag.IsOuterVertex(v)) {
+                  ctx.outer_residual.Add(tid, v, push, SumReducer());
+                } else {
+                  atomic_add(ctx.next_residual[v], push);
+                  ctx.touched.Insert(v);
+                }
+              }
+            });
+
+    double dangling = 0, total_dangling = 0;
+    for (auto d : dangling_tid) {
+      dangling += d;
+    }
+    Sum(dangling, total_dangling);
+    ctx.uniform_residual += total_dangling / ctx.graph_vnum;
+
+#ifdef PROFILING
+    ctx.counters.Stop(PhaseCounters::kExec);
+    ctx.exec_time += GetCurrentTime();
+    ctx.postprocess_time -= GetCurrentTime();
+    ctx.counters.Start(PhaseCounters::kPostprocess);
+#endif
+
+    // ship only the outer vertices which received residual in this round.
+    ctx.outer_residual.Flush(*this, frag, channels);
+
+    ForEach(ctx.touched, inner_vertices, [&ctx](int tid, vertex_t v) {
+      ctx.residual[v] += ctx.next_residual[v];
+      ctx.next_residual[v] = 0;
+      if (ctx.residual[v] > ctx.threshold) {
+        ctx.next_active.Insert(v);
+      }
+    });
+
+    // uniform_residual is identical on every worker, so all of them take
+    // this branch in the same round.
+    if (ctx.uniform_residual > ctx.threshold) {
+      double r = ctx.uniform_residual;
+      ctx.uniform_residual = 0;
+      ForEach(inner_vertices, [&ctx, r](int tid, vertex_t v) {
+        ctx.residual[v] += r;
+        if (ctx.residual[v] > ctx.threshold) {
+          ctx.next_active.Insert(v);
+        }
+      });
+    }
+
+    ctx.next_active.Swap(ctx.curr_active);
+
+    if (ctx.step < ctx.max_round &&
+        !ctx.curr_active.PartialEmpty(
+            frag.Vertices().begin_value(),
+            frag.Vertices().begin_value() + frag.GetInnerVerticesNum())) {
+      messages.ForceContinue();
+    }
+#ifdef PROFILING
+    ctx.counters.Stop(PhaseCounters::kPostprocess);
+    ctx.postprocess_time += GetCurrentTime();
+#endif
+  }
+};
+
 }  // namespace test
 
 #endif  // EXAMPLES_ANALYTICAL_APPS_PAGERANK_PAGERANK_H_
@@ -6,6 +6,10 @@
 #include <limits>
 #include <test/test.h>
 
+#include "adaptive_vertex_set.h"
+#include "outer_vertex_combiner.h"
+#include "perf_counters.h"
+
 namespace test {
 
 /**
@@ -35,6 +39,7 @@ class SSSPContext : public VertexDataContext<FRAG_T, double> {
     preprocess_time = 0;
     exec_time = 0;
     postprocess_time = 0;
+    counters.Init(frag.fid());
 #endif
   }
 
@@ -57,18 +62,22 @@ class SSSPContext : public VertexDataContext<FRAG_T, double> {
     VLOG(2) << "preprocess_time: " << preprocess_time << "s.";
     VLOG(2) << "exec_time: " << exec_time << "s.";
     VLOG(2) << "postprocess_time: " << postprocess_time << "s.";
+    counters.Output();
 #endif
   }
 
   oid_t source_id;
   typename FRAG_T::template vertex_array_t<double>& partial_result;
 
-  DenseVertexSet<typename FRAG_T::vertices_t> curr_modified, next_modified;
+  AdaptiveVertexSet<typename FRAG_T::vertices_t> curr_modified, next_modified;
+  // distances to outer vertices found in PEval, one message per vertex.
+  OuterVertexCombiner<FRAG_T, double> outer_dist;
 
 #ifdef PROFILING
   double preprocess_time = 0;
   double exec_time = 0;
   double postprocess_time = 0;
+  PhaseCounters counters;
 #endif
 };
 
@@ -101,20 +110,20 @@ class SSSP : public ParallelAppBase<FRAG_T, SSSPContext<FRAG_T>>,
   void PEval(const fragment_t& frag, context_t& ctx,
              message_manager_t& messages) {
     messages.InitChannels(thread_num());
+    ctx.outer_dist.Init(frag, std::numeric_limits<double>::max(),
+                        thread_num());
 
     vertex_t source;
     bool native_source = frag.GetInnerVertex(ctx.source_id, source);
 
 #ifdef PROFILING
+    ctx.counters.BeginStep();
     ctx.exec_time -= GetCurrentTime();
+    ctx.counters.Start(PhaseCounters::kExec);
 #endif
 
     ctx.next_modified.ParallelClear(GetThreadPool());
 
-    // Get the channel. Messages assigned to this channel will be sent by the
-    // message manager in parallel with the evaluation process.
-    auto& channel_0 = messages.Channels()[0];
-
     if (native_source) {
       ctx.partial_result[source] = 0;
       auto es = frag.GetOutgoingAdjList(source);
@@ -123,24 +132,30 @@ class SSSP : public ParallelAppBase<FRAG_T, SSSPContext<FRAG_T>>,
         ctx.partial_result[v] =
             std::min(ctx.partial_result[v], static_cast<double>(e.get_data()));
         if (frag.IsOuterVertex(v)) {
-          // put the message to the channel.
-          channel_0.SyncStateOnOuterVertex<fragment_t, double>(
-              frag, v, ctx.partial_result[v]);
+          // parallel edges to v are combined into one message.
+          ctx.outer_dist.Add(0, v, ctx.partial_result[v], MinReducer());
         } else {
           ctx.next_modified.Insert(v);
         }
       }
     }
 
+    // Messages put into the channels will be sent by the message manager in
+    // parallel with the evaluation process.
+    ctx.outer_dist.Flush(*this, frag, messages.Channels());
+
 #ifdef PROFILING
+    ctx.counters.Stop(PhaseCounters::kExec);
     ctx.exec_time += GetCurrentTime();
     ctx.postprocess_time -= GetCurrentTime();
+    ctx.counters.Start(PhaseCounters::kPostprocess);
 #endif
 
     messages.ForceContinue();
 
     ctx.next_modified.Swap(ctx.curr_modified);
 #ifdef PROFILING
+    ctx.counters.Stop(PhaseCounters::kPostprocess);
     ctx.postprocess_time += GetCurrentTime();
 #endif
   }
@@ -159,7 +174,9 @@ class SSSP : public ParallelAppBase<FRAG_T, SSSPContext<FRAG_T>>,
     auto& channels = messages.Channels();
 
 #ifdef PROFILING
+    ctx.counters.BeginStep();
     ctx.preprocess_time -= GetCurrentTime();
+    ctx.counters.Start(PhaseCounters::kPreprocess);
 #endif
 
     ctx.next_modified.ParallelClear(GetThreadPool());
@@ -174,37 +191,41 @@ class SSSP : public ParallelAppBase<FRAG_T, SSSPContext<FRAG_T>>,
         });
 
 #ifdef PROFILING
+    ctx.counters.Stop(PhaseCounters::kPreprocess);
     ctx.preprocess_time += GetCurrentTime();
     ctx.exec_time -= GetCurrentTime();
+    ctx.counters.Start(PhaseCounters::kExec);
 #endif
 
     // incremental evaluation.
-    ForEach(ctx.curr_modified, inner_vertices,
-            [&frag, &ctx](int tid, vertex_t v) {
-              double distv = ctx.partial_result[v];
-              auto es = frag.GetOutgoingAdjList(v);
-              for (auto& e : es) {
-                vertex_t u = e.get_neighbor();
-                double ndistu = distv + e.get_data();
-                if (ndistu < ctx.partial_result[u]) {
-                  atomic_min(ctx.partial_result[u], ndistu);
-                  ctx.next_modified.Insert(u);
-                }
-              }
-            });
+    ctx.curr_modified.ForEach(
+        *this, inner_vertices, [&frag, &ctx](int tid, vertex_t v) {
+          double distv = ctx.partial_result[v];
+          auto es = frag.GetOutgoingAdjList(v);
+          for (auto& e : es) {
+            vertex_t u = e.get_neighbor();
+            double ndistu = distv + e.get_data();
+            if (ndistu < ctx.partial_result[u]) {
+              atomic_min(ctx.partial_result[u], ndistu);
+              ctx.next_modified.Insert(u);
+            }
+          }
+        });
 
     // put messages into channels corresponding to the destination fragments.
 
 #ifdef PROFILING
+    ctx.counters.Stop(PhaseCounters::kExec);
     ctx.exec_time += GetCurrentTime();
     ctx.postprocess_time -= GetCurrentTime();
+    ctx.counters.Start(PhaseCounters::kPostprocess);
 #endif
     auto outer_vertices = frag.OuterVertices();
-    ForEach(ctx.next_modified, outer_vertices,
-            [&channels, &frag, &ctx](int tid, vertex_t v) {
-              channels[tid].SyncStateOnOuterVertex<fragment_t, double>(
-                  frag, v, ctx.partial_result[v]);
-            });
+    ctx.next_modified.ForEach(
+        *this, outer_vertices, [&channels, &frag, &ctx](int tid, vertex_t v) {
+          channels[tid].SyncStateOnOuterVertex<fragment_t, double>(
+              frag, v, ctx.partial_result[v]);
+        });
 
     if (!ctx.next_modified.PartialEmpty(
             frag.Vertices().begin_value(),
@@ -214,6 +235,7 @@ class SSSP : public ParallelAppBase<FRAG_T, SSSPContext<FRAG_T>>,
 
     ctx.next_modified.Swap(ctx.curr_modified);
 #ifdef PROFILING
+    ctx.counters.Stop(PhaseCounters::kPostprocess);
     ctx.postprocess_time += GetCurrentTime();
 #endif
   }
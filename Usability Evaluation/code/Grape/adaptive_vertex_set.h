@@ -0,0 +1,147 @@
+#ifndef EXAMPLES_ANALYTICAL_APPS_ADAPTIVE_VERTEX_SET_H_
+#define EXAMPLES_ANALYTICAL_APPS_ADAPTIVE_VERTEX_SET_H_
+
+#include <algorithm>
+#include <atomic>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <test/test.h>
+
+namespace test {
+
+/**
+ * @brief A frontier with the interface of DenseVertexSet that stays sparse
+ * while few vertices are in it.
+ *
+ * The bitmap is always kept, it gives Exist and deduplicates concurrent
+ * Inserts. Newly inserted vertices are also appended to a queue, until the
+ * queue holds more vertices than the bitmap has words (range size / 64 by
+ * default). Until then, iterating, counting and clearing the set touch only
+ * the queued vertices, so a round with a handful of active vertices costs
+ * O(active) instead of O(|V|). Once the queue overflows the set behaves as
+ * a plain DenseVertexSet until it is cleared.
+ *
+ * @tparam VERTEX_SET_T
+ */
+template <typename VERTEX_SET_T>
+class AdaptiveVertexSet {
+ public:
+  using vertex_t = typename std::decay<decltype(
+      *std::declval<VERTEX_SET_T>().begin())>::type;
+  using vid_t = typename std::decay<decltype(
+      std::declval<vertex_t>().GetValue())>::type;
+
+  AdaptiveVertexSet() : size_(0), capacity_(0) {}
+
+  void Init(const VERTEX_SET_T& range, double sparse_ratio = 1.0 / 64) {
+    dense_.Init(range);
+    capacity_ = std::max<size_t>(
+        1, static_cast<size_t>(static_cast<double>(range.size()) *
+                               sparse_ratio));
+    queue_.resize(capacity_);
+    size_.store(0, std::memory_order_relaxed);
+  }
+
+  void Insert(const vertex_t& v) {
+    if (dense_.InsertWithRet(v) &&
+        size_.load(std::memory_order_relaxed) <= capacity_) {
+      size_t idx = size_.fetch_add(1, std::memory_order_relaxed);
+      if (idx < capacity_) {
+        queue_[idx] = v;
+      }
+    }
+  }
+
+  bool Exist(const vertex_t& v) const { return dense_.Exist(v); }
+
+  // true once more vertices were inserted than the queue holds.
+  bool IsDense() const {
+    return size_.load(std::memory_order_relaxed) > capacity_;
+  }
+
+  void ParallelClear(ThreadPool& thread_pool) {
+    size_t size = size_.load(std::memory_order_relaxed);
+    if (size > capacity_ || size > kSerialClear) {
+      dense_.ParallelClear(thread_pool);
+    } else {
+      for (size_t i = 0; i < size; ++i) {
+        dense_.Erase(queue_[i]);
+      }
+    }
+    size_.store(0, std::memory_order_relaxed);
+  }
+
+  void Swap(AdaptiveVertexSet& rhs) {
+    dense_.Swap(rhs.dense_);
+    queue_.swap(rhs.queue_);
+    std::swap(capacity_, rhs.capacity_);
+    size_t size = size_.load(std::memory_order_relaxed);
+    size_.store(rhs.size_.load(std::memory_order_relaxed),
+                std::memory_order_relaxed);
+    rhs.size_.store(size, std::memory_order_relaxed);
+  }
+
+  bool PartialEmpty(vid_t beg, vid_t end) const {
+    if (IsDense()) {
+      return dense_.PartialEmpty(beg, end);
+    }
+    size_t size = size_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < size; ++i) {
+      vid_t v = queue_[i].GetValue();
+      if (v >= beg && v < end) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  size_t ParallelPartialCount(ThreadPool& thread_pool, vid_t beg,
+                              vid_t end) const {
+    if (IsDense()) {
+      return dense_.ParallelPartialCount(thread_pool, beg, end);
+    }
+    size_t size = size_.load(std::memory_order_relaxed), count = 0;
+    for (size_t i = 0; i < size; ++i) {
+      vid_t v = queue_[i].GetValue();
+      count += (v >= beg && v < end);
+    }
+    return count;
+  }
+
+  /**
+   * @brief Calls iter_func(tid, v) on every vertex of the set in range, like
+   * ParallelEngine::ForEach over a DenseVertexSet.
+   */
+  template <typename RANGE_T, typename ITER_FUNC_T>
+  void ForEach(ParallelEngine& engine, const RANGE_T& range,
+               const ITER_FUNC_T& iter_func) const {
+    if (IsDense()) {
+      engine.ForEach(dense_, range, iter_func);
+      return;
+    }
+    size_t size = size_.load(std::memory_order_relaxed);
+    vid_t beg = range.begin_value(), end = range.end_value();
+    engine.ForEach(queue_.begin(), queue_.begin() + size,
+                   [&iter_func, beg, end](int tid, vertex_t v) {
+                     if (v.GetValue() >= beg && v.GetValue() < end) {
+                       iter_func(tid, v);
+                     }
+                   },
+                   64);
+  }
+
+ private:
+  // up to this many queued vertices are erased one by one on clear.
+  static constexpr size_t kSerialClear = 4096;
+
+  DenseVertexSet<VERTEX_SET_T> dense_;
+  std::vector<vertex_t> queue_;
+  std::atomic<size_t> size_;
+  size_t capacity_;
+};
+
+}  // namespace test
+
+#endif  // EXAMPLES_ANALYTICAL_APPS_ADAPTIVE_VERTEX_SET_H_
@@ -0,0 +1,95 @@
+#ifndef EXAMPLES_ANALYTICAL_APPS_OUTER_VERTEX_COMBINER_H_
+#define EXAMPLES_ANALYTICAL_APPS_OUTER_VERTEX_COMBINER_H_
+
+#include <vector>
+
+#include <test/test.h>
+
+namespace test {
+
+/**
+ * @brief Reducers for OuterVertexCombiner, safe to call from several threads
+ * on the same slot.
+ */
+struct MinReducer {
+  template <typename T>
+  void operator()(T& slot, const T& msg) const {
+    atomic_min(slot, msg);
+  }
+};
+
+struct SumReducer {
+  template <typename T>
+  void operator()(T& slot, const T& msg) const {
+    atomic_add(slot, msg);
+  }
+};
+
+/**
+ * @brief Sender-side combining of the messages a fragment sends to the owners
+ * of its outer vertices within one round.
+ *
+ * Every outer vertex has one slot, messages to it are reduced into the slot
+ * and the first message to a vertex records it in the list of the sending
+ * thread. Flush sends one message per recorded vertex through the channels
+ * and resets the slots, so a vertex reached over many edges or from many
+ * threads costs one message on the wire and one call in the receiver's
+ * ParallelProcess.
+ *
+ * @tparam FRAG_T
+ * @tparam MSG_T
+ */
+template <typename FRAG_T, typename MSG_T>
+class OuterVertexCombiner {
+ public:
+  using vertex_t = typename FRAG_T::vertex_t;
+
+  void Init(const FRAG_T& frag, const MSG_T& identity, int thread_num) {
+    identity_ = identity;
+    slots_.Init(frag.OuterVertices(), identity);
+    sent_.Init(frag.OuterVertices());
+    lists_.clear();
+    lists_.resize(thread_num);
+  }
+
+  /**
+   * @brief Reduces msg into the slot of the outer vertex v, from thread tid.
+   */
+  template <typename REDUCER_T>
+  void Add(int tid, vertex_t v, const MSG_T& msg, const REDUCER_T& reducer) {
+    reducer(slots_[v], msg);
+    if (sent_.InsertWithRet(v)) {
+      lists_[tid].push_back(v);
+    }
+  }
+
+  /**
+   * @brief Sends the combined message of every outer vertex added since the
+   * last flush. Must not run concurrently with Add.
+   */
+  template <typename CHANNELS_T>
+  void Flush(ParallelEngine& engine, const FRAG_T& frag,
+             CHANNELS_T& channels) {
+    for (auto& list : lists_) {
+      engine.ForEach(list.begin(), list.end(),
+                     [this, &frag, &channels](int tid, vertex_t v) {
+                       channels[tid]
+                           .template SyncStateOnOuterVertex<FRAG_T, MSG_T>(
+                               frag, v, slots_[v]);
+                       slots_[v] = identity_;
+                       sent_.Erase(v);
+                     });
+      list.clear();
+    }
+  }
+
+ private:
+  MSG_T identity_;
+  typename FRAG_T::template vertex_array_t<MSG_T> slots_;
+  DenseVertexSet<typename FRAG_T::vertices_t> sent_;
+  std::vector<std::vector<vertex_t>> lists_;
+};
+
+}  // namespace test
+
+#endif  // EXAMPLES_ANALYTICAL_APPS_OUTER_VERTEX_COMBINER_H_
@@ -0,0 +1,246 @@
+#ifndef EXAMPLES_ANALYTICAL_APPS_PERF_COUNTERS_H_
+#define EXAMPLES_ANALYTICAL_APPS_PERF_COUNTERS_H_
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#include <test/test.h>
+
+namespace test {
+
+/**
+ * @brief Hardware counters around the PROFILING phases of an app.
+ *
+ * Init opens one perf_event_open group per thread of the process (the
+ * thread pool included; threads started later are not counted): cycles,
+ * instructions, LLC misses, dTLB misses and branch misses. Start/Stop of a
+ * phase read every group and add the deltas, scaled for multiplexing, to
+ * the current superstep's record of that phase, along with its wall time.
+ * Events the machine does not have are reported as -1; if no group can be
+ * opened (no permission, not Linux) only the time is kept.
+ *
+ * Output logs one line per superstep and phase, tagged with the fragment id.
+ */
+class PhaseCounters {
+ public:
+  enum Phase { kPreprocess = 0, kExec = 1, kPostprocess = 2, kPhaseNum = 3 };
+  enum Event {
+    kCycles = 0,
+    kInstructions = 1,
+    kLLCMisses = 2,
+    kDTLBMisses = 3,
+    kBranchMisses = 4,
+    kEventNum = 5
+  };
+
+  struct Record {
+    double time = 0;
+    double count[kEventNum] = {0, 0, 0, 0, 0};
+  };
+
+  PhaseCounters() = default;
+  PhaseCounters(const PhaseCounters&) = delete;
+  PhaseCounters& operator=(const PhaseCounters&) = delete;
+  ~PhaseCounters() { Close(); }
+
+  void Init(fid_t fid) {
+    Close();
+    fid_ = fid;
+    steps_.clear();
+    for (int e = 0; e < kEventNum; ++e) {
+      has_event_[e] = false;
+    }
+#ifdef __linux__
+    DIR* dir = opendir("/proc/self/task");
+    if (dir == nullptr) {
+      return;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+      if (entry->d_name[0] != '.') {
+        OpenGroup(atoi(entry->d_name));
+      }
+    }
+    closedir(dir);
+#endif
+    if (groups_.empty()) {
+      LOG(INFO) << "[frag-" << fid_
+                << "] perf counters unavailable, timing only.";
+    }
+  }
+
+  bool Available() const { return !groups_.empty(); }
+
+  // Starts a new superstep, call at the top of PEval and IncEval.
+  void BeginStep() { steps_.emplace_back(kPhaseNum); }
+
+  void Start(Phase phase) {
+    if (steps_.empty()) {
+      BeginStep();
+    }
+    Read(start_[phase]);
+    start_time_[phase] = GetCurrentTime();
+  }
+
+  void Stop(Phase phase) {
+    Record& record = steps_.back()[phase];
+    record.time += GetCurrentTime() - start_time_[phase];
+    std::vector<Sample> now;
+    Read(now);
+    for (size_t g = 0; g < now.size() && g < start_[phase].size(); ++g) {
+      const Sample& a = start_[phase][g];
+      const Sample& b = now[g];
+      uint64_t running = b.running - a.running;
+      double scale =
+          running == 0 ? 0.0 : static_cast<double>(b.enabled - a.enabled) /
+                                   static_cast<double>(running);
+      for (int e = 0; e < kEventNum; ++e) {
+        record.count[e] += static_cast<double>(b.value[e] - a.value[e]) * scale;
+      }
+    }
+  }
+
+  void Output() const {
+    static const char* phase_names[kPhaseNum] = {"preprocess", "exec",
+                                                 "postprocess"};
+    for (size_t s = 0; s < steps_.size(); ++s) {
+      for (int p = 0; p < kPhaseNum; ++p) {
+        const Record& r = steps_[s][p];
+        if (r.time == 0) {
+          continue;
+        }
+        VLOG(2) << "[frag-" << fid_ << "] step " << s << " "
+                << phase_names[p] << " time: " << r.time
+                << "s. cycles: " << Count(r, kCycles)
+                << " instructions: " << Count(r, kInstructions)
+                << " llc_misses: " << Count(r, kLLCMisses)
+                << " dtlb_misses: " << Count(r, kDTLBMisses)
+                << " branch_misses: " << Count(r, kBranchMisses);
+      }
+    }
+  }
+
+  const std::vector<std::vector<Record>>& Steps() const { return steps_; }
+
+ private:
+  struct Sample {
+    uint64_t enabled = 0;
+    uint64_t running = 0;
+    uint64_t value[kEventNum] = {0, 0, 0, 0, 0};
+  };
+
+  struct Group {
+    int fd[kEventNum];
+  };
+
+  double Count(const Record& r, Event e) const {
+    return has_event_[e] ? r.count[e] : -1;
+  }
+
+#ifdef __linux__
+  static int Open(uint32_t type, uint64_t config, int tid, int group_fd) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = (group_fd == -1);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(
+        syscall(__NR_perf_event_open, &attr, tid, -1, group_fd, 0));
+  }
+
+  static uint64_t CacheConfig(uint64_t cache) {
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+           (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  }
+
+  void OpenGroup(int tid) {
+    static const uint32_t types[kEventNum] = {
+        PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+        PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE};
+    const uint64_t configs[kEventNum] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        CacheConfig(PERF_COUNT_HW_CACHE_LL),
+        CacheConfig(PERF_COUNT_HW_CACHE_DTLB), PERF_COUNT_HW_BRANCH_MISSES};
+    Group group;
+    group.fd[kCycles] = Open(types[kCycles], configs[kCycles], tid, -1);
+    if (group.fd[kCycles] < 0) {
+      return;
+    }
+    for (int e = 1; e < kEventNum; ++e) {
+      group.fd[e] = Open(types[e], configs[e], tid, group.fd[kCycles]);
+    }
+    // the same events open on every thread, the first group decides.
+    if (groups_.empty()) {
+      for (int e = 0; e < kEventNum; ++e) {
+        has_event_[e] = group.fd[e] >= 0;
+      }
+    }
+    ioctl(group.fd[kCycles], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(group.fd[kCycles], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    groups_.push_back(group);
+  }
+#endif
+
+  // with PERF_FORMAT_GROUP the values come in the order the events were
+  // added to the group, missing events are skipped.
+  void Read(std::vector<Sample>& samples) const {
+    samples.resize(groups_.size());
+#ifdef __linux__
+    uint64_t buf[3 + kEventNum];
+    for (size_t g = 0; g < groups_.size(); ++g) {
+      Sample& sample = samples[g];
+      sample = Sample();
+      ssize_t n = read(groups_[g].fd[kCycles], buf, sizeof(buf));
+      if (n < static_cast<ssize_t>(3 * sizeof(uint64_t))) {
+        continue;
+      }
+      sample.enabled = buf[1];
+      sample.running = buf[2];
+      uint64_t k = 0;
+      for (int e = 0; e < kEventNum && k < buf[0]; ++e) {
+        if (groups_[g].fd[e] >= 0) {
+          sample.value[e] = buf[3 + k++];
+        }
+      }
+    }
+#endif
+  }
+
+  void Close() {
+    for (auto& group : groups_) {
+      for (int e = kEventNum - 1; e >= 0; --e) {
+        if (group.fd[e] >= 0) {
+          close(group.fd[e]);
+        }
+      }
+    }
+    groups_.clear();
+  }
+
+  fid_t fid_ = 0;
+  bool has_event_[kEventNum] = {false, false, false, false, false};
+  std::vector<Group> groups_;
+  std::vector<Sample> start_[kPhaseNum];
+  double start_time_[kPhaseNum] = {0, 0, 0};
+  std::vector<std::vector<Record>> steps_;
+};
+
+}  // namespace test
+
+#endif  // EXAMPLES_ANALYTICAL_APPS_PERF_COUNTERS_H_
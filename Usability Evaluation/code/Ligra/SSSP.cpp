@@ -1,5 +1,8 @@
 #define WEIGHTED 1
 #include "test.h"
+#include "quickSort.h"
+#include <map>
+#include <vector>
 struct BF_F {
   intE* ShortestPathLen;
   int* Visited;
@@ -30,15 +33,180 @@ struct BF_Vertex_F {
     return 1;
   }
 };
+//relaxes either the light (edgeLen <= delta) or the heavy edges of the
+//frontier; used by delta-stepping
+struct DS_F {
+  intE* ShortestPathLen;
+  int* Visited;
+  intE delta;
+  bool light;
+  DS_F(intE* _ShortestPathLen, int* _Visited, intE _delta, bool _light) :
+    ShortestPathLen(_ShortestPathLen), Visited(_Visited), delta(_delta), light(_light) {}
+  inline bool update (uintE s, uintE d, intE edgeLen) {
+    if((edgeLen <= delta) != light) return 0;
+    intE newDist = ShortestPathLen[s] + edgeLen;
+    if(ShortestPathLen[d] > newDist) {
+      ShortestPathLen[d] = newDist;
+      if(Visited[d] == 0) { Visited[d] = 1 ; return 1;}
+    }
+    return 0;
+  }
+  inline bool updateAtomic (uintE s, uintE d, intE edgeLen){
+    if((edgeLen <= delta) != light) return 0;
+    intE newDist = ShortestPathLen[s] + edgeLen;
+    return (writeMin(&ShortestPathLen[d],newDist) &&
+	    CAS(&Visited[d],0,1));
+  }
+  inline bool cond (uintE d) { return cond_true(d); }
+};
+
+//bucket of a vertex is derived from its current distance, so a vertex whose
+//distance drops into an earlier bucket never has to be moved explicitly
+struct DS_Bucket_F {
+  intE* ShortestPathLen;
+  intE delta;
+  DS_Bucket_F(intE* _ShortestPathLen, intE _delta) :
+    ShortestPathLen(_ShortestPathLen), delta(_delta) {}
+  inline intE operator() (uintE i) { return ShortestPathLen[i] / delta; }
+};
+
+//orders vertices by their current bucket
+struct DS_BucketLT {
+  DS_Bucket_F bkt;
+  DS_BucketLT(DS_Bucket_F _bkt) : bkt(_bkt) {}
+  bool operator () (uintE a, uintE b) { return bkt(a) < bkt(b); }
+};
+
+//open buckets, each with its own list, so a bucket costs O(its size). A
+//vertex whose distance drops is appended to its new bucket instead of being
+//moved; the stale copy left in a later bucket is dropped on extraction
+//because the vertex no longer maps to that bucket.
+struct DS_Pool {
+  long n;
+  map<intE,vector<uintE> > B;
+  int* Taken;
+  DS_Pool(long _n) : n(_n) {
+    Taken = newA(int,n);
+    {parallel_for(long i=0;i<n;i++) Taken[i] = 0;}
+  }
+  void del() { free(Taken); }
+  bool empty() { return B.empty(); }
+  //appends the vertices of S to their buckets, one range copy per bucket
+  void add(vertexSubset& S, DS_Bucket_F bkt) {
+    S.toSparse();
+    long k = S.numNonzeros();
+    DS_BucketLT lt(bkt);
+    quickSort(S.s,k,lt);
+    for(long i=0;i<k;) {
+      long j = i+1;
+      intE b = bkt(S.s[i]);
+      while(j < k && bkt(S.s[j]) == b) j++;
+      vector<uintE>& L = B[b];
+      L.insert(L.end(),S.s+i,S.s+j);
+      i = j;
+    }
+  }
+  //smallest open bucket
+  intE minBucket() { return B.begin()->first; }
+  //removes bucket b and returns its vertices that still belong to it, once
+  vertexSubset extract(DS_Bucket_F bkt, intE b) {
+    vector<uintE> S;
+    S.swap(B[b]);
+    B.erase(b);
+    long m = S.size();
+    bool* flags = newA(bool,m);
+    {parallel_for(long i=0;i<m;i++)
+	flags[i] = bkt(S[i]) == b && CAS(&Taken[S[i]],0,1);}
+    _seq<uintE> out = sequence::pack(S.data(), (uintE*) NULL, flags, m);
+    {parallel_for(long i=0;i<out.n;i++) Taken[out.A[i]] = 0;}
+    free(flags);
+    return vertexSubset(n,out.n,out.A);
+  }
+};
+
+//returns true if some edge has negative length; delta-stepping needs
+//non-negative lengths, Bellman-Ford is used otherwise
+template <class vertex>
+bool hasNegativeEdge(graph<vertex>& GA) {
+  long n = GA.n;
+  bool* neg = newA(bool,n);
+  {parallel_for(long i=0;i<n;i++) {
+      neg[i] = 0;
+      for(long j=0;j<GA.V[i].getOutDegree();j++)
+	if(GA.V[i].getOutWeight(j) < 0) { neg[i] = 1; break; }
+    }}
+  long count = sequence::sum(neg,n);
+  free(neg);
+  return count > 0;
+}
+
+//delta-stepping: vertices are processed bucket by bucket (bucket width
+//delta). Light edges are relaxed until the current bucket stays empty, then
+//the heavy edges of every vertex settled in it are relaxed once.
+template <class vertex>
+void DeltaStepping(graph<vertex>& GA, intE* ShortestPathLen, int* Visited, long start, intE delta) {
+  long n = GA.n;
+  DS_Bucket_F bkt(ShortestPathLen,delta);
+  DS_Pool pool(n);
+  int* Settled = newA(int,n);
+  {parallel_for(long i=0;i<n;i++) Settled[i] = 0;}
+  uintE* R = newA(uintE,n);
+  bool* Flags = newA(bool,n);
+  vertexSubset Start(n,start);
+  pool.add(Start,bkt);
+  Start.del();
+  while(!pool.empty()) {
+    intE b = pool.minBucket();
+    vertexSubset Frontier = pool.extract(bkt,b);
+    long rSize = 0;
+    while(!Frontier.isEmpty()) { //light phase
+      Frontier.toSparse();
+      long k = Frontier.numNonzeros();
+      {parallel_for(long i=0;i<k;i++) Flags[i] = CAS(&Settled[Frontier.s[i]],0,1);}
+      rSize += sequence::pack(Frontier.s, R+rSize, Flags, k).n;
+      vertexSubset output = edgeMap(GA, Frontier, DS_F(ShortestPathLen,Visited,delta,true), GA.m/20, dense_forward);
+      vertexMap(output,BF_Vertex_F(Visited));
+      Frontier.del();
+      //vertices that stay in bucket b are relaxed again in this phase
+      output.toSparse();
+      long m = output.numNonzeros();
+      {parallel_for(long i=0;i<m;i++) Flags[i] = bkt(output.s[i]) == b;}
+      _seq<uintE> same = sequence::pack(output.s, (uintE*) NULL, Flags, m);
+      {parallel_for(long i=0;i<m;i++) Flags[i] = !Flags[i];}
+      _seq<uintE> later = sequence::pack(output.s, (uintE*) NULL, Flags, m);
+      vertexSubset Later(n,later.n,later.A);
+      pool.add(Later,bkt);
+      Later.del(); output.del();
+      Frontier = vertexSubset(n,same.n,same.A);
+    }
+    Frontier.del();
+    {parallel_for(long i=0;i<rSize;i++) Settled[R[i]] = 0;}
+    uintE* heavy = newA(uintE,rSize);
+    {parallel_for(long i=0;i<rSize;i++) heavy[i] = R[i];}
+    vertexSubset Heavy(n,rSize,heavy);
+    vertexSubset output = edgeMap(GA, Heavy, DS_F(ShortestPathLen,Visited,delta,false), GA.m/20, dense_forward);
+    vertexMap(output,BF_Vertex_F(Visited));
+    pool.add(output,bkt);
+    output.del(); Heavy.del();
+  }
+  pool.del(); free(Settled); free(R); free(Flags);
+}
+
 template <class vertex>
 void Compute(graph<vertex>& GA, commandLine P) {
   long start = P.getOptionLongValue("-r",0);
+  long delta = P.getOptionLongValue("-delta",0); //bucket width, 0 = Bellman-Ford
   long n = GA.n;
   intE* ShortestPathLen = newA(intE,n);
   {parallel_for(long i=0;i<n;i++) ShortestPathLen[i] = INT_MAX/2;}
   ShortestPathLen[start] = 0;
   int* Visited = newA(int,n);
   {parallel_for(long i=0;i<n;i++) Visited[i] = 0;}
+  if(delta > 0 && !hasNegativeEdge(GA)) {
+    DeltaStepping(GA,ShortestPathLen,Visited,start,(intE)delta);
+    free(Visited); free(ShortestPathLen);
+    return;
+  }
   vertexSubset Frontier(n,start); //initial frontier
   long round = 0;
   while(!Frontier.isEmpty()){
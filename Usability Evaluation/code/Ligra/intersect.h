@@ -0,0 +1,88 @@
+#ifndef LIGRA_INTERSECT_H
+#define LIGRA_INTERSECT_H
+
+// Sorted-set intersection kernels. Both inputs are sorted in increasing
+// order without duplicates; every function returns |A \cap B|.
+//
+// The vector kernels compare a block of A against every rotation of a block
+// of B (all-pairs compare), then advance whichever block has the smaller
+// last element. There is no data dependent branch inside a block, so the
+// cost is bound by loading A and B instead of by branch mispredictions. The
+// tails are finished by the scalar merge.
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#include "parallel.h"  // uintE
+
+namespace intersect {
+
+//branch-light two-pointer merge
+inline long countCommonScalar(const uintE* A, long nA, const uintE* B, long nB) {
+  long i = 0, j = 0, ans = 0;
+  while (i < nA && j < nB) {
+    uintE a = A[i], b = B[j];
+    ans += (a == b);
+    i += (a <= b);
+    j += (b <= a);
+  }
+  return ans;
+}
+
+#if defined(__AVX2__)
+inline long countCommonAVX2(const uintE* A, long nA, const uintE* B, long nB) {
+  long i = 0, j = 0, ans = 0;
+  const __m256i rot = _mm256_setr_epi32(1,2,3,4,5,6,7,0);
+  while (i + 8 <= nA && j + 8 <= nB) {
+    __m256i va = _mm256_loadu_si256((const __m256i*)(A+i));
+    __m256i vb = _mm256_loadu_si256((const __m256i*)(B+j));
+    __m256i eq = _mm256_cmpeq_epi32(va,vb);
+    for (int r = 1; r < 8; r++) {
+      vb = _mm256_permutevar8x32_epi32(vb,rot);
+      eq = _mm256_or_si256(eq,_mm256_cmpeq_epi32(va,vb));
+    }
+    ans += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(eq)));
+    uintE aMax = A[i+7], bMax = B[j+7];
+    i += (aMax <= bMax) ? 8 : 0;
+    j += (bMax <= aMax) ? 8 : 0;
+  }
+  return ans + countCommonScalar(A+i, nA-i, B+j, nB-j);
+}
+#endif
+
+#if defined(__AVX512F__)
+inline long countCommonAVX512(const uintE* A, long nA, const uintE* B, long nB) {
+  long i = 0, j = 0, ans = 0;
+  const __m512i rot = _mm512_setr_epi32(1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,0);
+  while (i + 16 <= nA && j + 16 <= nB) {
+    __m512i va = _mm512_loadu_si512((const void*)(A+i));
+    __m512i vb = _mm512_loadu_si512((const void*)(B+j));
+    __mmask16 eq = _mm512_cmpeq_epi32_mask(va,vb);
+    for (int r = 1; r < 16; r++) {
+      vb = _mm512_permutexvar_epi32(rot,vb);
+      eq |= _mm512_cmpeq_epi32_mask(va,vb);
+    }
+    ans += __builtin_popcount(eq);
+    uintE aMax = A[i+15], bMax = B[j+15];
+    i += (aMax <= bMax) ? 16 : 0;
+    j += (bMax <= aMax) ? 16 : 0;
+  }
+  return ans + countCommonScalar(A+i, nA-i, B+j, nB-j);
+}
+#endif
+
+//picks the widest kernel the build targets
+inline long countCommon(const uintE* A, long nA, const uintE* B, long nB) {
+#if defined(__AVX512F__)
+  return countCommonAVX512(A, nA, B, nB);
+#elif defined(__AVX2__)
+  return countCommonAVX2(A, nA, B, nB);
+#else
+  return countCommonScalar(A, nA, B, nB);
+#endif
+}
+
+}
+
+#endif
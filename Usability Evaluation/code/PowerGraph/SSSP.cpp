@@ -2,6 +2,7 @@
 #include <string>
 #include <fstream>
 #include <test.hpp>
+#include "min_priority.hpp"
 typedef float distance_type;
 
 struct vertex_data : test::IS_POD_TYPE {
@@ -33,6 +34,7 @@ struct min_distance_type : test::IS_POD_TYPE {
     dist = std::min(dist, other.dist);
     return *this;
   }
+  double priority() const { return min_priority(dist); }
 };
 
 class sssp :
@@ -123,6 +125,7 @@ int main(int argc, char** argv) {
   std::string format = "adj";
   std::string exec_type = "synchronous";
   size_t powerlaw = 0;
+  bool priority = false;
   std::vector<unsigned int> sources;
   bool max_degree_source = false;
   clopts.attach_option("graph", graph_dir,
@@ -143,6 +146,8 @@ int main(int argc, char** argv) {
 
   clopts.attach_option("engine", exec_type,
                        "The engine type synchronous or asynchronous");
+  clopts.attach_option("priority", priority,
+                       "Run asynchronously, smallest tentative distance first");
 
 
   clopts.attach_option("powerlaw", powerlaw,
@@ -198,6 +203,9 @@ int main(int argc, char** argv) {
 
 
   // Running The Engine -------------------------------------------------------
+  if (priority) {
+    use_min_priority_scheduler(clopts, exec_type);
+  }
   test::omni_engine<sssp> engine(dc, graph, exec_type, clopts);
 
 
@@ -0,0 +1,34 @@
+#ifndef MIN_PRIORITY_HPP
+#define MIN_PRIORITY_HPP
+
+#include <string>
+#include <test.hpp>
+
+/*
+ * Priority ordering for min-combining messages.
+ *
+ * The priority scheduler of the asynchronous engine keeps pending vertices
+ * in several concurrent priority queues, pops from a random one of them and
+ * so runs an approximately highest priority vertex next. The priority of a
+ * vertex is priority() of its combined message. Min-combining programs
+ * (shortest paths, label propagation) return min_priority(payload), so the
+ * smallest pending payload runs first and most vertices apply once with
+ * their final value.
+ */
+template <typename T>
+inline double min_priority(const T& value) {
+  return -static_cast<double>(value);
+}
+
+/*
+ * Selects asynchronous execution with the priority scheduler. The
+ * synchronous engine runs every signaled vertex in each superstep, so it
+ * has no order to change.
+ */
+inline void use_min_priority_scheduler(test::command_line_options& clopts,
+                                       std::string& exec_type) {
+  exec_type = "asynchronous";
+  clopts.set_scheduler_type("priority");
+}
+
+#endif
@@ -1,9 +1,11 @@
 #include "basic/test-dev.h"
+#include "arena.h"
+#include "binary_graph.h"
 using namespace std;
 struct PRValue_test
 {
 	double pr;
-	vector<VertexID> edges;
+	AdjList<VertexID> edges;
 };
 
 ibinstream & operator<<(ibinstream & m, const PRValue_test & v){
@@ -20,7 +22,7 @@ obinstream & operator>>(obinstream & m, PRValue_test & v){
 
 //====================================
 
-class PRVertex_test:public Vertex<VertexID, PRValue_test, double>
+class PRVertex_test:public Vertex<VertexID, PRValue_test, double>, public ArenaObject
 {
 	public:
 		virtual void compute(MessageContainer & messages)
@@ -43,10 +45,7 @@ class PRVertex_test:public Vertex<VertexID, PRValue_test, double>
 			if(step_num()<ROUND)
 			{
 				double msg=value().pr/value().edges.size();
-				for(vector<VertexID>::iterator it=value().edges.begin(); it!=value().edges.end(); it++)
-				{
-					send_message(*it, msg);
-				}
+				broadcast(this, value().edges.begin(), value().edges.end(), msg);
 			}
 			else vote_to_halt();
 		}
@@ -74,15 +73,50 @@ class PRAgg_test:public Aggregator<PRVertex_test, double, double>
 			sum+=*part;
 		}
 
+		//per-thread copies (see ThreadedWorker)
+		void merge(const PRAgg_test & other)
+		{
+			sum+=other.sum;
+		}
+
 		virtual double* finishPartial(){ return &sum; }
 		virtual double* finishFinal(){ return &sum; }
 };
 
-class PRWorker_test:public Worker<PRVertex_test, PRAgg_test>
+class PRWorker_test:public BinaryWorker<PRVertex_test, PRAgg_test>
 {
 	char buf[100];
 	public:
 
+		//edges are used in place in the mapped file
+		virtual PRVertex_test* toVertex(VertexID id, const VertexID* nbs, int num)
+		{
+			PRVertex_test* v=new PRVertex_test;
+			v->id=id;
+			v->value().edges.attach(nbs, num);
+			return v;
+		}
+
+		static AdjList<VertexID> & edges_of(PRVertex_test* v){ return v->value().edges; }
+
+		//releases the vertices and edges shipped away while loading
+		virtual void compact()
+		{
+			compact_arena(this->vertexes, edges_of);
+		}
+
+		virtual const VertexID* mirror_edges(PRVertex_test* v, int & num)
+		{
+			num=v->value().edges.size();
+			return v->value().edges.data();
+		}
+
+		virtual void tobinary(PRVertex_test* v, BinaryWriter & writer)
+		{
+			writer.write(v->id);
+			writer.write(v->value().pr);
+		}
+
 		virtual PRVertex_test* toVertex(char* line)
 		{
 			char * pch;
@@ -115,7 +149,8 @@ class PRCombiner_test:public Combiner<double>
 		}
 };
 
-void test_pagerank(string in_path, string out_path, bool use_combiner){
+//num_threads: compute threads per worker
+void test_pagerank(string in_path, string out_path, bool use_combiner, int num_threads=1){
 	WorkerParams param;
 	param.input_path=in_path;
 	param.output_path=out_path;
@@ -124,9 +159,10 @@ void test_pagerank(string in_path, string out_path, bool use_combiner){
 	PRWorker_test worker;
 	PRCombiner_test combiner;
 	if(use_combiner) worker.setCombiner(&combiner);
+	worker.setNumThreads(num_threads);
 	PRAgg_test agg;
 	worker.setAggregator(&agg);
-	worker.run(param);
+	worker.run_text(param);
 }
 
 void test_pagerank_report(string in_path, string out_path, string report_path, bool use_combiner){
@@ -142,3 +178,21 @@ void test_pagerank_report(string in_path, string out_path, string report_path, b
 	worker.setAggregator(&agg);
 	worker.run_report(param, report_path);
 }
+
+//in_path: binary adjacency file (see text_to_binary)
+//out_path: local directory, one file of (id, pr) records per worker
+//mirror_threshold: vertices with at least this many out-edges are mirrored, 0 disables
+//num_threads: compute threads per worker
+void test_pagerank_binary(string in_path, string out_path, bool use_combiner, int mirror_threshold=0, int num_threads=1){
+	WorkerParams param;
+	param.input_path=in_path;
+	param.output_path=out_path;
+	PRWorker_test worker;
+	PRCombiner_test combiner;
+	if(use_combiner) worker.setCombiner(&combiner);
+	worker.setMirrorThreshold(mirror_threshold);
+	worker.setNumThreads(num_threads);
+	PRAgg_test agg;
+	worker.setAggregator(&agg);
+	worker.run_binary(param);
+}
@@ -1,5 +1,7 @@
 #include "basic/test-dev.h"
 #include <float.h>
+#include "arena.h"
+#include "binary_graph.h"
 using namespace std;
 
 int src=0;
@@ -28,7 +30,7 @@ struct SPValue_test
 {
 	double dist;
 	int from;
-	vector<SPEdge_test> edges;
+	AdjList<SPEdge_test> edges;
 };
 
 ibinstream & operator<<(ibinstream & m, const SPValue_test & v){
@@ -67,18 +69,18 @@ obinstream & operator>>(obinstream & m, SPMsg_test & v){
 
 //====================================
 
-class SPVertex_test:public Vertex<VertexID, SPValue_test, SPMsg_test>
+class SPVertex_test:public Vertex<VertexID, SPValue_test, SPMsg_test>, public ArenaObject
 {
 	public:
 		void broadcast()
 		{
-			vector<SPEdge_test> & nbs=value().edges;
+			AdjList<SPEdge_test> & nbs=value().edges;
 			for(int i=0; i<nbs.size(); i++)
 			{
 				SPMsg_test msg;
 				msg.dist=value().dist+nbs[i].len;
 				msg.from=id;
-				send_message(nbs[i].nb, msg);
+				send_to(this, nbs[i].nb, msg);
 			}
 		}
 
@@ -124,12 +126,48 @@ class SPVertex_test:public Vertex<VertexID, SPValue_test, SPMsg_test>
 
 };
 
-class SPWorker_test:public Worker<SPVertex_test>
+class SPWorker_test:public BinaryWorker<SPVertex_test>
 {
 	char buf[1000];
 
 	public:
 
+		//edges carry a length, so the neighbors are copied into the pool
+		virtual SPVertex_test* toVertex(VertexID id, const VertexID* nbs, int num)
+		{
+			SPVertex_test* v=new SPVertex_test;
+			v->id=id;
+			v->value().from=-1;
+			if(id==src) v->value().dist=0;
+			else
+			{
+				v->value().dist=DBL_MAX;
+				v->vote_to_halt();
+			}
+			for(int i=0; i<num; i++)
+			{
+				SPEdge_test edge={1, nbs[i]};
+				v->value().edges.push_back(edge);
+			}
+			return v;
+		}
+
+		static AdjList<SPEdge_test> & edges_of(SPVertex_test* v){ return v->value().edges; }
+
+		//releases the vertices and edges shipped away while loading
+		virtual void compact()
+		{
+			compact_arena(this->vertexes, edges_of);
+		}
+
+		//output record: vid dist from
+		virtual void tobinary(SPVertex_test* v, BinaryWriter & writer)
+		{
+			writer.write(v->id);
+			writer.write(v->value().dist);
+			writer.write(v->value().from);
+		}
+
 		//input line:
 		virtual SPVertex_test* toVertex(char* line)
 		{
@@ -174,7 +212,8 @@ class SPCombiner_test:public Combiner<SPMsg_test>
 		}
 };
 
-void test_sssp(int srcID, string in_path, string out_path, bool use_combiner){
+//num_threads: compute threads per worker
+void test_sssp(int srcID, string in_path, string out_path, bool use_combiner, int num_threads=1){
 	src=srcID;//set the src first
 
 	WorkerParams param;
@@ -185,5 +224,20 @@ void test_sssp(int srcID, string in_path, string out_path, bool use_combiner){
 	SPWorker_test worker;
 	SPCombiner_test combiner;
 	if(use_combiner) worker.setCombiner(&combiner);
-	worker.run(param);
+	worker.setNumThreads(num_threads);
+	worker.run_text(param);
+}
+
+//num_threads: compute threads per worker
+void test_sssp_binary(int srcID, string in_path, string out_path, bool use_combiner, int num_threads=1){
+	src=srcID;//set the src first
+
+	WorkerParams param;
+	param.input_path=in_path;
+	param.output_path=out_path;
+	SPWorker_test worker;
+	SPCombiner_test combiner;
+	if(use_combiner) worker.setCombiner(&combiner);
+	worker.setNumThreads(num_threads);
+	worker.run_binary(param);
 }
@@ -0,0 +1,208 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "basic/test-dev.h"
+#include <vector>
+#include <new>
+#include <type_traits>
+#include <cstdlib>
+#include <cstddef>
+using namespace std;
+
+//====================================
+//bump allocator: objects are carved out of large chunks and never freed one
+//by one, all chunks are released with the arena (see compact_arena)
+
+class Arena
+{
+	public:
+		Arena(size_t chunk_size=(64<<20)):chunk_size(chunk_size), cur(NULL), left(0){}
+
+		~Arena()
+		{
+			for(int i=0; i<chunks.size(); i++) free(chunks[i]);
+		}
+
+		void* allocate(size_t size)
+		{
+			const size_t align=alignof(max_align_t);
+			size=(size+align-1)/align*align;
+			if(size>left)
+			{
+				size_t bytes=size>chunk_size?size:chunk_size;
+				cur=(char*)malloc(bytes);
+				chunks.push_back(cur);
+				left=bytes;
+			}
+			void* p=cur;
+			cur+=size;
+			left-=size;
+			return p;
+		}
+
+		void swap(Arena & other)
+		{
+			std::swap(chunk_size, other.chunk_size);
+			std::swap(cur, other.cur);
+			std::swap(left, other.left);
+			chunks.swap(other.chunks);
+		}
+
+	private:
+		size_t chunk_size;
+		char* cur;
+		size_t left;
+		vector<char*> chunks;
+};
+
+inline Arena & vertex_arena()
+{
+	static Arena arena;
+	return arena;
+}
+
+//vertex classes derive from ArenaObject so that "new VertexT" (in toVertex
+//and when vertices are deserialized) takes memory from vertex_arena(); the
+//delete issued by the worker is a no-op
+struct ArenaObject
+{
+	static void* operator new(size_t size){ return vertex_arena().allocate(size); }
+	static void operator delete(void* p){}
+};
+
+//====================================
+//all adjacency lists of a worker live in one flat pool per edge type, a
+//vertex keeps (offset, length) into it. Lists are built one at a time (in
+//toVertex or when a vertex is deserialized); extending an older list moves
+//it to the end. Lists of vertices shipped to another worker during loading
+//are left behind in the pool until compact_arena.
+
+template <class EdgeT>
+inline vector<EdgeT> & adj_pool()
+{
+	static vector<EdgeT> pool;
+	return pool;
+}
+
+template <class EdgeT>
+class AdjList
+{
+	public:
+		//edges are read-only once added, attached lists point into a
+		//read-only mapping; change a list with push_back/clear/resize
+		typedef EdgeT value_type;
+		typedef const EdgeT* iterator;
+		typedef const EdgeT* const_iterator;
+
+		AdjList():offset(0), length(0), mapped(false){}
+
+		//uses n edges that stay valid for the whole job (e.g. a mapped
+		//input file) without copying them into the pool
+		void attach(const EdgeT* edges, int n)
+		{
+			offset=(size_t)edges;
+			length=n;
+			mapped=true;
+		}
+
+		const EdgeT* data() const { return mapped?(const EdgeT*)offset:adj_pool<EdgeT>().data()+offset; }
+		const_iterator begin() const { return data(); }
+		const_iterator end() const { return data()+length; }
+		int size() const { return length; }
+		bool is_mapped() const { return mapped; }
+		const EdgeT & operator[](int i) const { return data()[i]; }
+
+		void push_back(const EdgeT & e)
+		{
+			vector<EdgeT> & pool=adj_pool<EdgeT>();
+			if(length==0) offset=pool.size();
+			else if(mapped || offset+length!=pool.size())
+			{//another list was started since, move this one to the end
+				pool.reserve(pool.size()+length+1);
+				const EdgeT* old=data();
+				offset=pool.size();
+				for(int i=0; i<length; i++) pool.push_back(old[i]);
+			}
+			mapped=false;
+			pool.push_back(e);
+			length++;
+		}
+
+		//drops the list, its slots in the pool are not reused
+		void clear(){ length=0; mapped=false; }
+
+		//keeps the first n entries
+		void resize(int n){ if(n<length) length=n; }
+
+		//copies a pooled list to the end of pool (mapped lists stay where
+		//they are); pool is to become adj_pool<EdgeT>()
+		void relocate(vector<EdgeT> & pool)
+		{
+			if(mapped) return;
+			const EdgeT* old=data();
+			size_t at=pool.size();
+			pool.insert(pool.end(), old, old+length);
+			offset=at;
+		}
+
+	private:
+		size_t offset;//address of the first edge if mapped
+		int length;
+		bool mapped;
+};
+
+//same wire format as vector<EdgeT>
+template <class EdgeT>
+ibinstream & operator<<(ibinstream & m, const AdjList<EdgeT> & v){
+	size_t size=v.size();
+	m<<size;
+	for(typename AdjList<EdgeT>::const_iterator it=v.begin(); it!=v.end(); it++) m<<*it;
+	return m;
+}
+
+template <class EdgeT>
+obinstream & operator>>(obinstream & m, AdjList<EdgeT> & v){
+	size_t size;
+	m>>size;
+	v=AdjList<EdgeT>();
+	for(size_t i=0; i<size; i++)
+	{
+		EdgeT e;
+		m>>e;
+		v.push_back(e);
+	}
+	return m;
+}
+
+//====================================
+//rebuilds vertex_arena() and the adjacency pool from the vertices a worker
+//keeps: sync_graph ships the others away, and their objects and lists would
+//otherwise stay in the arena and the pool for the whole job. adj_of(v) is
+//the adjacency list of v; the pointers in vertexes are replaced by those of
+//the copies, so call it before anything else holds on to them
+
+template <class VertexT, class AdjOfT>
+void compact_arena(vector<VertexT*> & vertexes, AdjOfT adj_of)
+{
+	typedef typename remove_reference<decltype(adj_of(vertexes[0]))>::type::value_type EdgeT;
+	size_t total=0;
+	for(size_t i=0; i<vertexes.size(); i++)
+	{
+		if(!adj_of(vertexes[i]).is_mapped()) total+=adj_of(vertexes[i]).size();
+	}
+	vector<EdgeT> pool;
+	pool.reserve(total);
+	Arena fresh;
+	for(size_t i=0; i<vertexes.size(); i++)
+	{
+		VertexT* v=vertexes[i];
+		adj_of(v).relocate(pool);
+		VertexT* copy=::new(fresh.allocate(sizeof(VertexT))) VertexT(*v);
+		v->~VertexT();
+		vertexes[i]=copy;
+	}
+	adj_pool<EdgeT>().swap(pool);
+	vertex_arena().swap(fresh);
+}
+
+#endif
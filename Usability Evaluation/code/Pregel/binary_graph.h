@@ -0,0 +1,310 @@
+#ifndef BINARY_GRAPH_H
+#define BINARY_GRAPH_H
+
+#include "basic/test-dev.h"
+#include "arena.h"
+#include "threaded_worker.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+using namespace std;
+
+//binary adjacency file (local file system), written by text_to_binary:
+//  BinaryGraphHeader
+//  long long part_begin[num_parts+1]     first record of each part
+//  long long rec_offset[num_vertices+1]  VertexID offset of each record in data
+//  VertexID data[]                       records "id num nb_1 ... nb_num"
+//records are grouped by part (id % num_parts, like DefaultHash). A job on
+//num_parts workers maps exactly its own part and ships no vertex; otherwise
+//the data area is split evenly by bytes and vertices are shipped as usual.
+
+struct BinaryGraphHeader
+{
+	char magic[4];
+	int num_parts;
+	long long num_vertices;
+	long long num_edges;
+};
+
+static const char BINARY_GRAPH_MAGIC[4]={'P', 'G', 'B', '1'};
+
+//====================================
+//text to binary converter, input lines: vid \t num n1 n2 ...
+
+class PartBuffer
+{
+	public:
+		PartBuffer(int fd, off_t pos):fd(fd), pos(pos){}
+		~PartBuffer(){ flush(); }
+
+		template <class T>
+		void write(const T & v)
+		{
+			const char* p=(const char*)&v;
+			buf.insert(buf.end(), p, p+sizeof(T));
+			if(buf.size()>=(1<<20)) flush();
+		}
+
+		void flush()
+		{
+			if(buf.empty()) return;
+			if(pwrite(fd, buf.data(), buf.size(), pos)!=(ssize_t)buf.size())
+			{
+				perror("pwrite");
+				exit(-1);
+			}
+			pos+=buf.size();
+			buf.clear();
+		}
+
+	private:
+		int fd;
+		off_t pos;
+		vector<char> buf;
+};
+
+//parses "vid \t num n1 n2 ..." with strtol (re-entrant); returns false on a
+//line without a vertex
+inline bool parse_adj_line(char* line, VertexID & id, vector<VertexID> & nbs)
+{
+	char* end;
+	nbs.clear();
+	id=strtol(line, &end, 10);
+	if(end==line) return false;
+	line=end;
+	int num=strtol(line, &end, 10);
+	line=end;
+	for(int i=0; i<num; i++)
+	{
+		nbs.push_back(strtol(line, &end, 10));
+		line=end;
+	}
+	return true;
+}
+
+inline void text_to_binary(const char* in_path, const char* out_path, int num_parts)
+{
+	FILE* in=fopen(in_path, "r");
+	if(in==NULL){ perror(in_path); exit(-1); }
+	size_t cap=0;
+	char* line=NULL;
+	VertexID id;
+	vector<VertexID> nbs;
+	//pass 1: size of every part
+	vector<long long> part_vnum(num_parts, 0), part_words(num_parts, 0);
+	while(getline(&line, &cap, in)!=-1)
+	{
+		if(!parse_adj_line(line, id, nbs)) continue;
+		int p=(id<0?-id:id)%num_parts;
+		part_vnum[p]++;
+		part_words[p]+=2+nbs.size();
+	}
+	BinaryGraphHeader h;
+	memcpy(h.magic, BINARY_GRAPH_MAGIC, 4);
+	h.num_parts=num_parts;
+	h.num_vertices=0;
+	long long words=0;
+	vector<long long> part_begin(num_parts+1), word_begin(num_parts+1);
+	for(int p=0; p<num_parts; p++)
+	{
+		part_begin[p]=h.num_vertices;
+		word_begin[p]=words;
+		h.num_vertices+=part_vnum[p];
+		words+=part_words[p];
+	}
+	part_begin[num_parts]=h.num_vertices;
+	word_begin[num_parts]=words;
+	h.num_edges=words-2*h.num_vertices;
+	//pass 2: write every record and its index entry at its part's cursor
+	int fd=open(out_path, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+	if(fd<0){ perror(out_path); exit(-1); }
+	off_t index_pos=sizeof(h)+sizeof(long long)*(num_parts+1);
+	off_t data_pos=index_pos+sizeof(long long)*(h.num_vertices+1);
+	{
+		PartBuffer head(fd, 0);
+		head.write(h);
+		for(int p=0; p<=num_parts; p++) head.write(part_begin[p]);
+	}
+	vector<PartBuffer*> index(num_parts), data(num_parts);
+	vector<long long> cursor(word_begin.begin(), word_begin.end()-1);
+	for(int p=0; p<num_parts; p++)
+	{
+		index[p]=new PartBuffer(fd, index_pos+sizeof(long long)*part_begin[p]);
+		data[p]=new PartBuffer(fd, data_pos+sizeof(VertexID)*word_begin[p]);
+	}
+	rewind(in);
+	while(getline(&line, &cap, in)!=-1)
+	{
+		if(!parse_adj_line(line, id, nbs)) continue;
+		int p=(id<0?-id:id)%num_parts;
+		index[p]->write(cursor[p]);
+		data[p]->write(id);
+		data[p]->write((VertexID)nbs.size());
+		for(int i=0; i<nbs.size(); i++) data[p]->write(nbs[i]);
+		cursor[p]+=2+nbs.size();
+	}
+	for(int p=0; p<num_parts; p++)
+	{
+		delete index[p];
+		delete data[p];
+	}
+	{
+		PartBuffer tail(fd, index_pos+sizeof(long long)*h.num_vertices);
+		tail.write(words);
+	}
+	free(line);
+	fclose(in);
+	close(fd);
+}
+
+//====================================
+//read-only mapping of a binary adjacency file
+
+class MappedGraph
+{
+	public:
+		MappedGraph():base(NULL), size(0){}
+		~MappedGraph(){ if(base!=NULL) munmap(base, size); }
+
+		void open(const char* path)
+		{
+			int fd=::open(path, O_RDONLY);
+			if(fd<0){ perror(path); exit(-1); }
+			struct stat st;
+			fstat(fd, &st);
+			size=st.st_size;
+			base=(char*)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+			close(fd);
+			if(base==MAP_FAILED){ perror("mmap"); exit(-1); }
+			header=(BinaryGraphHeader*)base;
+			if(memcmp(header->magic, BINARY_GRAPH_MAGIC, 4)!=0)
+			{
+				fprintf(stderr, "%s: not a binary graph\n", path);
+				exit(-1);
+			}
+			part_begin=(long long*)(header+1);
+			rec_offset=part_begin+header->num_parts+1;
+			data=(VertexID*)(rec_offset+header->num_vertices+1);
+		}
+
+		//true if the file is partitioned for this number of workers
+		bool partitioned_for(int num_workers){ return header->num_parts==num_workers; }
+
+		//records [begin, end) of a worker: its own part if the file is
+		//partitioned for num_workers, an even byte range of data otherwise
+		void range(int rank, int num_workers, long long & begin, long long & end)
+		{
+			if(partitioned_for(num_workers))
+			{
+				begin=part_begin[rank];
+				end=part_begin[rank+1];
+				return;
+			}
+			long long n=header->num_vertices, words=rec_offset[n];
+			begin=lower_bound(rec_offset, rec_offset+n, words*rank/num_workers)-rec_offset;
+			end=lower_bound(rec_offset, rec_offset+n, words*(rank+1)/num_workers)-rec_offset;
+		}
+
+		VertexID id(long long k){ return data[rec_offset[k]]; }
+		int num(long long k){ return data[rec_offset[k]+1]; }
+		const VertexID* nbs(long long k){ return data+rec_offset[k]+2; }
+
+	private:
+		char* base;
+		size_t size;
+		BinaryGraphHeader* header;
+		long long* part_begin;
+		long long* rec_offset;
+		VertexID* data;
+};
+
+//====================================
+//fixed-size result records, one local file per worker
+
+class BinaryWriter
+{
+	public:
+		BinaryWriter(const char* dir, int rank)
+		{
+			mkdir(dir, 0755);
+			char path[1000];
+			sprintf(path, "%s/part_%d.bin", dir, rank);
+			fp=fopen(path, "wb");
+			if(fp==NULL){ perror(path); exit(-1); }
+			setvbuf(fp, NULL, _IOFBF, 1<<20);
+		}
+		~BinaryWriter(){ fclose(fp); }
+
+		template <class T>
+		void write(const T & v){ fwrite(&v, sizeof(T), 1, fp); }
+
+	private:
+		FILE* fp;
+};
+
+//====================================
+//worker that can also run on a binary adjacency file: run_binary loads the
+//mapped file instead of the text splits, runs the supersteps of
+//ThreadedWorker (threads, mirrors, see threaded_worker.h) and dumps with
+//tobinary instead of toline
+
+template <class VertexT, class AggregatorT = DummyAgg>
+class BinaryWorker:public ThreadedWorker<VertexT, AggregatorT>
+{
+	public:
+		using Worker<VertexT, AggregatorT>::toVertex;
+
+		//builds a vertex from a record; nbs stays mapped until the job ends
+		virtual VertexT* toVertex(VertexID id, const VertexID* nbs, int num)=0;
+
+		virtual void tobinary(VertexT* v, BinaryWriter & writer)=0;
+
+		void load_binary(const char* inpath)
+		{
+			graph.open(inpath);
+			long long begin, end;
+			graph.range(_my_rank, _num_workers, begin, end);
+			for(long long k=begin; k<end; k++)
+			{
+				this->add_vertex(toVertex(graph.id(k), graph.nbs(k), graph.num(k)));
+			}
+		}
+
+		void dump_binary(const char* outpath)
+		{
+			BinaryWriter writer(outpath, _my_rank);
+			for(int i=0; i<this->vertexes.size(); i++) tobinary(this->vertexes[i], writer);
+		}
+
+		void run_binary(const WorkerParams & params)
+		{
+			init_timers();
+			ResetTimer(WORKER_TIMER);
+			load_binary(params.input_path.c_str());
+			//a file partitioned for this job already holds the hash partition
+			if(!graph.partitioned_for(_num_workers))
+			{
+				this->sync_graph();
+				this->compact();
+			}
+			this->finish_loading();
+
+			this->run_supersteps();
+
+			ResetTimer(WORKER_TIMER);
+			dump_binary(params.output_path.c_str());
+			StopTimer(WORKER_TIMER);
+			PrintTimer("Dump Time", WORKER_TIMER);
+			mirror_table()=NULL;
+		}
+
+	private:
+		MappedGraph graph;
+};
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef MIRROR_H
+#define MIRROR_H
+
+#include "basic/test-dev.h"
+#include "outbox.h"
+#include <vector>
+using namespace std;
+
+//====================================
+//mirrors of high-degree vertices: the out-edges of a hub are grouped by the
+//worker that owns the target, and every worker keeps the group it owns. A
+//broadcast from the hub then ships one (hub, msg) pair to each of those
+//workers, which expands it over its group into the local message buffer
+
+template <class MessageT>
+class MirrorTable
+{
+	public:
+		typedef vector<pair<VertexID, vector<VertexID> > > GroupList;
+
+		MirrorTable():threshold(0){}
+
+		int threshold;
+
+		bool is_hub(VertexID id)
+		{
+			return workers.find(id)!=workers.end();
+		}
+
+		//called on every worker with its own hubs and their out-edges
+		void build(vector<pair<VertexID, vector<VertexID> > > & hubs)
+		{
+			vector<GroupList> groups(_num_workers);
+			for(int i=0; i<hubs.size(); i++)
+			{
+				VertexID hub=hubs[i].first;
+				vector<VertexID> & nbs=hubs[i].second;
+				vector<vector<VertexID> > split(_num_workers);
+				for(int j=0; j<nbs.size(); j++) split[nbs[j]%_num_workers].push_back(nbs[j]);
+				vector<int> & dst=workers[hub];
+				for(int w=0; w<_num_workers; w++)
+				{
+					if(split[w].empty()) continue;
+					dst.push_back(w);
+					groups[w].push_back(make_pair(hub, vector<VertexID>()));
+					groups[w].back().second.swap(split[w]);
+				}
+				vector<VertexID>().swap(nbs);
+			}
+			all_to_all(groups);
+			for(int w=0; w<_num_workers; w++)
+			{
+				for(int i=0; i<groups[w].size(); i++)
+				{
+					targets[groups[w][i].first].swap(groups[w][i].second);
+				}
+			}
+			out.resize(_num_workers);
+		}
+
+		void broadcast(VertexID hub, const MessageT & msg)
+		{
+			vector<int> & dst=workers[hub];
+			for(int i=0; i<dst.size(); i++) out[dst[i]].push_back(make_pair(hub, msg));
+		}
+
+		//ships this superstep's broadcasts and expands the received ones;
+		//must run after compute and before the message buffer is synced
+		template <class MessageBufT>
+		void expand(MessageBufT* message_buffer)
+		{
+			all_to_all(out);
+			for(int w=0; w<_num_workers; w++)
+			{
+				for(int i=0; i<out[w].size(); i++)
+				{
+					vector<VertexID> & nbs=targets[out[w][i].first];
+					const MessageT & msg=out[w][i].second;
+					for(int j=0; j<nbs.size(); j++) message_buffer->add_message(nbs[j], msg);
+				}
+				out[w].clear();
+			}
+		}
+
+	private:
+		hash_map<VertexID, vector<int> > workers; //own hubs: workers holding a group
+		hash_map<VertexID, vector<VertexID> > targets; //groups held here
+		vector<vector<pair<VertexID, MessageT> > > out;
+};
+
+inline void* & mirror_table()
+{
+	static void* table=NULL;
+	return table;
+}
+
+//sends msg along every edge of v, through the mirrors if v is a hub
+template <class VertexT, class EdgeIterT>
+void broadcast(VertexT* v, EdgeIterT begin, EdgeIterT end, const typename VertexT::MessageType & msg)
+{
+	typedef typename VertexT::MessageType MessageT;
+	MirrorTable<MessageT>* table=(MirrorTable<MessageT>*)mirror_table();
+	if(table!=NULL && table->is_hub(v->id))
+	{
+		ThreadOutbox<MessageT>* box=(ThreadOutbox<MessageT>*)thread_outbox();
+		if(box!=NULL) box->hub_msgs.push_back(make_pair(v->id, msg));
+		else table->broadcast(v->id, msg);
+		return;
+	}
+	for(EdgeIterT it=begin; it!=end; it++) send_to(v, *it, msg);
+}
+
+#endif
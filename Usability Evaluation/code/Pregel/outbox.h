@@ -0,0 +1,63 @@
+#ifndef OUTBOX_H
+#define OUTBOX_H
+
+#include "basic/test-dev.h"
+#include <vector>
+using namespace std;
+
+//====================================
+//per-thread message buffer for multi-threaded compute (see BinaryWorker::
+//setNumThreads): messages sent by the vertices of one thread are combined
+//here and moved into the worker's message buffer once all threads are done
+
+template <class MessageT>
+class ThreadOutbox
+{
+	public:
+		ThreadOutbox():combiner(NULL){}
+
+		Combiner<MessageT>* combiner;
+		vector<pair<VertexID, MessageT> > msgs;
+		vector<pair<VertexID, MessageT> > hub_msgs; //broadcasts of mirrored hubs
+
+		void add(VertexID target, const MessageT & msg)
+		{
+			if(combiner==NULL)
+			{
+				msgs.push_back(make_pair(target, msg));
+				return;
+			}
+			pair<typename hash_map<VertexID, int>::iterator, bool> res=slot.insert(make_pair(target, (int)msgs.size()));
+			if(res.second) msgs.push_back(make_pair(target, msg));
+			else combiner->combine(msgs[res.first->second].second, msg);
+		}
+
+		void clear()
+		{
+			msgs.clear();
+			hub_msgs.clear();
+			slot.clear();
+		}
+
+	private:
+		hash_map<VertexID, int> slot; //target -> position in msgs
+};
+
+//outbox of the calling thread, NULL outside multi-threaded compute
+inline void* & thread_outbox()
+{
+	static thread_local void* box=NULL;
+	return box;
+}
+
+//sends msg to target; vertex programs that may run multi-threaded use it
+//instead of Vertex::send_message, which writes the shared message buffer
+template <class VertexT>
+void send_to(VertexT* v, VertexID target, const typename VertexT::MessageType & msg)
+{
+	ThreadOutbox<typename VertexT::MessageType>* box=(ThreadOutbox<typename VertexT::MessageType>*)thread_outbox();
+	if(box!=NULL) box->add(target, msg);
+	else v->send_message(target, msg);
+}
+
+#endif
@@ -0,0 +1,333 @@
+#ifndef THREADED_WORKER_H
+#define THREADED_WORKER_H
+
+#include "basic/test-dev.h"
+#include "outbox.h"
+#include "mirror.h"
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <type_traits>
+using namespace std;
+
+//====================================
+//fixed set of compute threads, started once per job and reused by every
+//superstep: run(job) calls job(t) on threads t=1..num-1 and on the calling
+//thread as t=0, and returns once all of them are done
+
+class ComputePool
+{
+	public:
+		ComputePool():num(1), generation(0), pending(0), stopping(false), job(NULL){}
+		~ComputePool(){ stop(); }
+
+		int size(){ return num; }
+
+		void start(int num_threads)
+		{
+			stop();
+			num=num_threads;
+			stopping=false;
+			for(int t=1; t<num; t++) threads.push_back(thread(&ComputePool::loop, this, t, generation));
+		}
+
+		void run(const function<void(int)> & f)
+		{
+			{
+				lock_guard<mutex> lock(mtx);
+				job=&f;
+				pending=num-1;
+				generation++;
+			}
+			wake.notify_all();
+			f(0);
+			unique_lock<mutex> lock(mtx);
+			while(pending>0) done.wait(lock);
+			job=NULL;
+		}
+
+		void stop()
+		{
+			{
+				lock_guard<mutex> lock(mtx);
+				stopping=true;
+			}
+			wake.notify_all();
+			for(int t=0; t<threads.size(); t++) threads[t].join();
+			threads.clear();
+			num=1;
+		}
+
+	private:
+		void loop(int t, long long seen)
+		{
+			while(true)
+			{
+				const function<void(int)>* f;
+				{
+					unique_lock<mutex> lock(mtx);
+					while(!stopping && generation==seen) wake.wait(lock);
+					if(stopping) return;
+					seen=generation;
+					f=job;
+				}
+				(*f)(t);
+				lock_guard<mutex> lock(mtx);
+				if(--pending==0) done.notify_one();
+			}
+		}
+
+		int num;
+		long long generation; //number of jobs run so far
+		int pending; //threads still busy with the current job
+		bool stopping;
+		const function<void(int)>* job;
+		vector<thread> threads;
+		mutex mtx;
+		condition_variable wake, done;
+};
+
+//true if AggregatorT has void merge(const AggregatorT &), which adds the
+//partial of another copy of the aggregator to this one
+template <class AggregatorT>
+class has_merge
+{
+	template <class U, void (U::*)(const U &)> struct sig{};
+	template <class U> static char test(sig<U, &U::merge>*);
+	template <class U> static long test(...);
+
+	public:
+		static const bool value=(sizeof(test<AggregatorT>(0))==1);
+};
+
+//====================================
+//worker whose supersteps can run on several threads: run_text is the job of
+//Worker::run with compact() after sync_graph and the superstep loop of
+//run_supersteps. With setMirrorThreshold, vertices of at least that degree
+//are mirrored (see mirror.h) and reach their neighbors through broadcast().
+//With setNumThreads, compute runs on that many threads per worker, started
+//once per job: vertex programs then send through send_to()/broadcast() (see
+//outbox.h). An aggregator with merge() (see has_merge) gets one copy per
+//thread, merged into it once all threads are done; any other aggregator is
+//fed under a lock
+
+template <class VertexT, class AggregatorT = DummyAgg>
+class ThreadedWorker:public Worker<VertexT, AggregatorT>
+{
+	public:
+		typedef typename VertexT::MessageType MessageT;
+
+		ThreadedWorker():num_threads(1){}
+
+		//out-neighbors of v, used to set up mirrors; none by default
+		virtual const VertexID* mirror_edges(VertexT* v, int & num)
+		{
+			num=0;
+			return NULL;
+		}
+
+		//called once the vertices of other workers have been shipped away
+		//(see compact_arena in arena.h); nothing by default
+		virtual void compact(){}
+
+		void setMirrorThreshold(int threshold)
+		{
+			mirrors.threshold=threshold;
+		}
+
+		void setNumThreads(int num)
+		{
+			num_threads=(num<1?1:num);
+		}
+
+		//all_compute/active_compute over the threads of the pool; vertices
+		//are handed out in chunks so that skewed degrees do not leave threads
+		//idle
+		void threaded_compute(bool wake_all)
+		{
+			typedef typename VertexT::MessageContainer MessageContainerT;
+			vector<VertexT*> & vertexes=this->vertexes;
+			vector<MessageContainerT> & v_msgbufs=this->message_buffer->get_v_msg_bufs();
+			AggregatorT* agg=(AggregatorT*)get_aggregator();
+			const bool local_aggs=(agg!=NULL && has_merge<AggregatorT>::value);
+			//agg has just been init()ed, so the copies start empty
+			vector<AggregatorT> aggs;
+			if(local_aggs) aggs.assign(num_threads-1, *agg);
+			mutex agg_mtx;
+			vector<long long> active(num_threads, 0);
+			atomic<long long> next(0);
+			const long long chunk=256, n=vertexes.size();
+			pool.run([&](int t)
+			{
+				ThreadOutbox<MessageT> & box=boxes[t];
+				box.combiner=(Combiner<MessageT>*)get_combiner();
+				thread_outbox()=&box;
+				AggregatorT* my_agg=(local_aggs && t>0 ? &aggs[t-1] : agg);
+				for(long long begin=next.fetch_add(chunk); begin<n; begin=next.fetch_add(chunk))
+				{
+					long long end=(begin+chunk<n ? begin+chunk : n);
+					for(long long i=begin; i<end; i++)
+					{
+						VertexT* v=vertexes[i];
+						if(wake_all || v_msgbufs[i].size()>0) v->activate();
+						else if(!v->is_active()) continue;
+						v->compute(v_msgbufs[i]);
+						v_msgbufs[i].clear();
+						if(my_agg!=NULL)
+						{
+							if(local_aggs) my_agg->stepPartial(v);
+							else
+							{
+								lock_guard<mutex> lock(agg_mtx);
+								my_agg->stepPartial(v);
+							}
+						}
+						if(v->is_active()) active[t]++;
+					}
+				}
+				thread_outbox()=NULL;
+			});
+			this->active_count=0;
+			for(int t=0; t<num_threads; t++)
+			{
+				this->active_count+=active[t];
+				vector<pair<VertexID, MessageT> > & msgs=boxes[t].msgs;
+				for(int i=0; i<msgs.size(); i++) this->message_buffer->add_message(msgs[i].first, msgs[i].second);
+				vector<pair<VertexID, MessageT> > & hub_msgs=boxes[t].hub_msgs;
+				for(int i=0; i<hub_msgs.size(); i++) mirrors.broadcast(hub_msgs[i].first, hub_msgs[i].second);
+				boxes[t].clear();
+			}
+			if(local_aggs) merge_aggs(agg, aggs, integral_constant<bool, has_merge<AggregatorT>::value>());
+		}
+
+		void build_mirrors()
+		{
+			vector<pair<VertexID, vector<VertexID> > > hubs;
+			for(int i=0; i<this->vertexes.size(); i++)
+			{
+				int num;
+				const VertexID* nbs=mirror_edges(this->vertexes[i], num);
+				if(num<mirrors.threshold) continue;
+				hubs.push_back(make_pair(this->vertexes[i]->id, vector<VertexID>(nbs, nbs+num)));
+			}
+			long long hub_num=all_sum_LL(hubs.size());
+			mirrors.build(hubs);
+			mirror_table()=&mirrors;
+			if(_my_rank==MASTER_RANK) cout<<"#mirrored hubs: "<<hub_num<<endl;
+		}
+
+		//message buffer and mirrors of the loaded graph, then "Load Time"
+		void finish_loading()
+		{
+			this->message_buffer->init(this->vertexes);
+			if(mirrors.threshold>0) build_mirrors();
+			worker_barrier();
+			StopTimer(WORKER_TIMER);
+			PrintTimer("Load Time", WORKER_TIMER);
+		}
+
+		//the superstep loop of Worker::run, with the compute step and the
+		//mirror expansion of this worker. Aggregators are reset at the start
+		//of every superstep, as Worker::run does
+		void run_supersteps()
+		{
+			if(num_threads>1)
+			{
+				pool.start(num_threads);
+				boxes.assign(num_threads, ThreadOutbox<MessageT>());
+			}
+			init_timers();
+			ResetTimer(WORKER_TIMER);
+			global_step_num=0;
+			long long step_msg_num;
+			while(true)
+			{
+				global_step_num++;
+				ResetTimer(4);
+				char bits_bor=all_bor(global_bor_bitmap);
+				if(getBit(FORCE_TERMINATE_ORBIT, bits_bor)==1) break;
+				get_vnum()=all_sum(this->vertexes.size());
+				int wakeAll=getBit(WAKE_ALL_ORBIT, bits_bor);
+				if(wakeAll==0)
+				{
+					active_vnum()=all_sum(this->active_count);
+					if(active_vnum()==0 && getBit(HAS_MSG_ORBIT, bits_bor)==0) break;
+				}
+				else active_vnum()=get_vnum();
+				AggregatorT* agg=(AggregatorT*)get_aggregator();
+				if(agg!=NULL) agg->init();
+				clearBits();
+				if(num_threads>1) threaded_compute(wakeAll==1);
+				else if(wakeAll==1) this->all_compute();
+				else this->active_compute();
+				if(mirrors.threshold>0) mirrors.expand(this->message_buffer);
+				this->message_buffer->combine();
+				step_msg_num=master_sum_LL(this->message_buffer->get_total_msg());
+				vector<VertexT*> & to_add=this->message_buffer->sync_messages();
+				this->agg_sync();
+				for(int i=0; i<to_add.size(); i++) this->add_vertex(to_add[i]);
+				to_add.clear();
+				worker_barrier();
+				StopTimer(4);
+				if(_my_rank==MASTER_RANK)
+				{
+					cout<<"Superstep "<<global_step_num<<" done. Time elapsed: "<<get_timer(4)<<" seconds"<<endl;
+					cout<<"#msgs: "<<step_msg_num<<endl;
+				}
+			}
+			worker_barrier();
+			StopTimer(WORKER_TIMER);
+			PrintTimer("Communication Time", COMMUNICATION_TIMER);
+			PrintTimer("- Serialization Time", SERIALIZATION_TIMER);
+			PrintTimer("- Transfer Time", TRANSFER_TIMER);
+			PrintTimer("Total Computational Time", WORKER_TIMER);
+			pool.stop();
+			boxes.clear();
+		}
+
+		void run_text(const WorkerParams & params)
+		{
+			if(dirCheck(params.input_path.c_str(), params.output_path.c_str(), _my_rank==MASTER_RANK, params.force_write)==-1) exit(-1);
+			init_timers();
+			ResetTimer(WORKER_TIMER);
+			vector<string> splits;
+			if(_my_rank==MASTER_RANK)
+			{
+				vector<vector<string> >* arrangement=params.native_dispatcher?dispatchLocality(params.input_path.c_str()):dispatchRan(params.input_path.c_str());
+				masterScatter(*arrangement);
+				splits.swap((*arrangement)[0]);
+				delete arrangement;
+			}
+			else slaveScatter(splits);
+			for(int i=0; i<splits.size(); i++) this->load_graph(splits[i].c_str());
+			this->sync_graph();
+			compact();
+			finish_loading();
+
+			run_supersteps();
+
+			ResetTimer(WORKER_TIMER);
+			this->dump_partition(params.output_path.c_str());
+			StopTimer(WORKER_TIMER);
+			PrintTimer("Dump Time", WORKER_TIMER);
+			mirror_table()=NULL;
+		}
+
+	private:
+		static void merge_aggs(AggregatorT* agg, vector<AggregatorT> & aggs, true_type)
+		{
+			for(int t=0; t<aggs.size(); t++) agg->merge(aggs[t]);
+		}
+
+		static void merge_aggs(AggregatorT* agg, vector<AggregatorT> & aggs, false_type){}
+
+		MirrorTable<MessageT> mirrors;
+		int num_threads;
+		ComputePool pool;
+		vector<ThreadOutbox<MessageT> > boxes;
+};
+
+#endif